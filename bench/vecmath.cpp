@@ -0,0 +1,138 @@
+// compares the SIMD kernels of vgl::math with the scalar loops they replaced, build with -DBUILD_BENCHMARKS=ON
+// (and -DAVX=ON for the AVX kernels), without FMA contraction both sides give bit identical results
+#include <vgl/vecmath.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+
+namespace vgl::internal {
+    using Matrix = std::array<std::array<GLfloat, 4>, 4>;
+
+    constexpr std::size_t _matrixCount = 1024;
+    constexpr std::size_t _productRounds = 2000;
+    constexpr std::size_t _pointCount = 100000;
+    constexpr std::size_t _pointRounds = 200;
+
+    // the scalar loops of the renderer before vgl::math, kept out of line so they are not folded into the timing loop
+    #if defined(__GNUC__)
+    __attribute__((noinline))
+    #endif
+    Matrix scalarProduct(const Matrix& a, const Matrix& b)
+    {
+        Matrix result;
+        for (std::size_t i = 0; i < 4; ++i) {
+            for (std::size_t j = 0; j < 4; ++j) {
+                result[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j] + a[i][3] * b[3][j];
+            }
+        }
+        return result;
+    }
+
+    #if defined(__GNUC__)
+    __attribute__((noinline))
+    #endif
+    void scalarTransformPoints(const Matrix& m, const GLfloat* points, std::size_t count, GLfloat* result)
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            const GLfloat* p = points + 3 * i;
+            for (std::size_t row = 0; row < 4; ++row) {
+                result[4 * i + row] = m[row][0] * p[0] + m[row][1] * p[1] + m[row][2] * p[2] + m[row][3];
+            }
+        }
+    }
+
+    template<typename Function>
+    double milliseconds(Function function)
+    {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    GLfloat maxDifference(const GLfloat* a, const GLfloat* b, std::size_t count)
+    {
+        GLfloat difference = 0.0f;
+        for (std::size_t i = 0; i < count; ++i) {
+            difference = std::max(difference, std::abs(a[i] - b[i]));
+        }
+        return difference;
+    }
+
+    void report(const char* name, double scalar, double simd, GLfloat difference)
+    {
+        std::printf("%-16s scalar %8.1f ms  simd %8.1f ms  %5.2fx  max difference %g\n", name, scalar, simd, scalar / simd, difference);
+    }
+} // namespace vgl::internal
+
+int main()
+{
+    using namespace vgl;
+    using internal::Matrix;
+
+    #if defined(__AVX__)
+    std::printf("kernels: AVX\n");
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    std::printf("kernels: SSE2\n");
+    #else
+    std::printf("kernels: scalar\n");
+    #endif
+
+    std::mt19937 random(42);
+    std::uniform_real_distribution<GLfloat> distribution(-1.0f, 1.0f);
+
+    std::vector<Matrix> matrices(internal::_matrixCount);
+    std::vector<math::Mat4> simdMatrices(internal::_matrixCount);
+    // rigid transforms, so the chained products below neither overflow nor vanish
+    for (std::size_t i = 0; i < matrices.size(); ++i) {
+        math::Vec3 axis = math::normalize(math::Vec3{distribution(random), distribution(random), distribution(random), 0.0f});
+        simdMatrices[i] = math::toMat4(math::fromAxisAngle(axis, 3.14159265f * distribution(random)));
+        for (std::size_t row = 0; row < 3; ++row) {
+            (&simdMatrices[i].rows[row].x)[3] = distribution(random);
+        }
+        matrices[i] = math::toArray(simdMatrices[i]);
+    }
+
+    // every product feeds the next one, so neither loop can be skipped or reordered
+    Matrix scalarResult = matrices[0];
+    double scalar = internal::milliseconds([&]() {
+        for (std::size_t round = 0; round < internal::_productRounds; ++round) {
+            for (std::size_t i = 0; i < matrices.size(); ++i) {
+                scalarResult = internal::scalarProduct(scalarResult, matrices[i]);
+            }
+        }
+    });
+    math::Mat4 simdResult = simdMatrices[0];
+    double simd = internal::milliseconds([&]() {
+        for (std::size_t round = 0; round < internal::_productRounds; ++round) {
+            for (std::size_t i = 0; i < simdMatrices.size(); ++i) {
+                simdResult = simdResult * simdMatrices[i];
+            }
+        }
+    });
+    internal::report("mat4 product", scalar, simd, internal::maxDifference(scalarResult[0].data(), &simdResult.rows[0].x, 16));
+
+    std::vector<GLfloat> points(3 * internal::_pointCount);
+    for (GLfloat& value : points) {
+        value = distribution(random);
+    }
+    std::vector<GLfloat> scalarPoints(4 * internal::_pointCount);
+    std::vector<GLfloat> simdPoints(4 * internal::_pointCount);
+    scalar = internal::milliseconds([&]() {
+        for (std::size_t round = 0; round < internal::_pointRounds; ++round) {
+            internal::scalarTransformPoints(matrices[round % matrices.size()], points.data(), internal::_pointCount, scalarPoints.data());
+        }
+    });
+    simd = internal::milliseconds([&]() {
+        for (std::size_t round = 0; round < internal::_pointRounds; ++round) {
+            math::transformPoints(simdMatrices[round % simdMatrices.size()], points.data(), internal::_pointCount, simdPoints.data());
+        }
+    });
+    internal::report("transformPoints", scalar, simd, internal::maxDifference(scalarPoints.data(), simdPoints.data(), scalarPoints.size()));
+
+    return 0;
+}
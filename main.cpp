@@ -27,6 +27,7 @@ int main()
     vgl::initialize();
     vgl::setOption(vgl::Option::DefaultShowWindow, true);
     vgl::setOption(vgl::Option::DefaultResizableWindow, true);
+    vgl::setProgramCacheDirectory("cache/programs");
 
     // vgl::Window w(100, 100, 800, 600, "VitalGL");
     // w.setTitle("VitalGL");
@@ -48,6 +48,9 @@ vgl::Window &vgl::App::window()
     size_t skippedFrames = 0;
     double deltaTime = 0.0;
 
+    // meshes added before run() get their programs compiled while the first frames are drawn
+    mScene.warmUpPrograms();
+
     lastTime = std::chrono::high_resolution_clock::now();
     while (!mWindow.shouldClose())
     {
@@ -79,7 +82,14 @@ vgl::Window &vgl::App::window()
         ++frames;
         timePassed += std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - frameStart).count();
         if (timePassed >= 1.0) {
-            std::cout << "FPS: " << frames << std::endl;
+            UniformStats stats = uniformStats();
+            std::cout << "FPS: " << frames << " (uniform uploads: " << stats.uploads
+                      << ", skipped: " << stats.skippedUploads;
+            if (mScene.occlusionCulling()) {
+                std::cout << ", occluded: " << static_cast<int>(mScene.occludedFraction() * 100.0f) << "%";
+            }
+            std::cout << ")" << std::endl;
+            resetUniformStats();
             timePassed = 0.;
             frames = 0;
         }
@@ -127,6 +137,9 @@ vgl::AsyncApp::AsyncApp(int x, int y, int width, int height, const std::string &
 
 void vgl::AsyncApp::run()
 {
+    // meshes have to be added before this, the first snapshot tells the rendering thread about all of them
+    mScene.camera().setAspectRatio(static_cast<float>(mWindow.aspectRatio()));
+    mScene.publish();
     window().releaseGLContext();
     mRenderThread = std::thread(&AsyncApp::renderLoop, this);
 
@@ -146,15 +159,25 @@ void vgl::AsyncApp::run()
         if (deltaTime > mTimeStep) {
             update(mTimeStep);
             deltaTime -= mTimeStep;
+            mScene.camera().setAspectRatio(static_cast<float>(mWindow.aspectRatio()));
+            mScene.publish();
         }
     }
     mShouldClose = true;
     mRenderThread.join();
 }
 
+void vgl::AsyncApp::draw()
+{
+    glViewport(0, 0, mWindow.width(), mWindow.height());
+    mScene.update();
+    mScene.draw();
+}
+
 void vgl::AsyncApp::renderLoop()
 {
     window().makeGLContextCurrent();
+    mScene.warmUpPrograms();
     while (!mShouldClose.load()) {
         draw();
         mWindow.swapBuffers();
@@ -48,6 +48,8 @@ public:
 
     [[noreturn]] void run() override;
     [[noreturn]] void renderLoop();
+    // the camera is only read from the published snapshot here, the updating thread sets its aspect ratio
+    void draw() override;
 
     virtual void update(double deltaTime) = 0;
 
@@ -0,0 +1,558 @@
+#include <vgl/bvh.h>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+
+namespace vgl::internal {
+    constexpr std::size_t _bvhBinCount = 12;
+    // below this depth the builder falls back to median splits, so degenerate inputs cannot exhaust the stack
+    constexpr std::size_t _bvhMaxSahDepth = 48;
+    constexpr std::size_t _bvhCostCheckInterval = 32;
+
+    using Box = std::array<std::array<GLfloat, 3>, 2>;
+
+    GLfloat surfaceArea(const std::array<GLfloat, 3>& min, const std::array<GLfloat, 3>& max)
+    {
+        GLfloat dx = max[0] - min[0];
+        GLfloat dy = max[1] - min[1];
+        GLfloat dz = max[2] - min[2];
+        return 2.0f * (dx * dy + dy * dz + dz * dx);
+    }
+
+    void grow(std::array<GLfloat, 3>& min, std::array<GLfloat, 3>& max, const std::array<GLfloat, 3>& otherMin, const std::array<GLfloat, 3>& otherMax)
+    {
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            min[axis] = std::min(min[axis], otherMin[axis]);
+            max[axis] = std::max(max[axis], otherMax[axis]);
+        }
+    }
+
+    Box emptyBox()
+    {
+        Box box;
+        box[0].fill(std::numeric_limits<GLfloat>::max());
+        box[1].fill(std::numeric_limits<GLfloat>::lowest());
+        return box;
+    }
+} // namespace vgl::internal
+
+// ===============================================================================================================
+// BoundingVolumeHierarchy
+// ===============================================================================================================
+
+vgl::BoundingVolumeHierarchy::~BoundingVolumeHierarchy()
+{
+    if (mRebuild.valid()) {
+        mRebuild.wait();
+    }
+}
+
+vgl::BoundingVolumeHierarchy::Handle vgl::BoundingVolumeHierarchy::insert(const Bounds &bounds, std::uint32_t value)
+{
+    Handle handle;
+    if (!mFreeHandles.empty()) {
+        handle = mFreeHandles.back();
+        mFreeHandles.pop_back();
+    } else {
+        handle = static_cast<Handle>(mObjects.size());
+        mObjects.emplace_back();
+    }
+
+    std::uint32_t leaf = allocateNode();
+    mNodes[leaf].min = bounds.min;
+    mNodes[leaf].max = bounds.max;
+    mNodes[leaf].handle = handle;
+    insertLeaf(leaf);
+
+    mObjects[handle] = Object{bounds.min, bounds.max, value, leaf, true, false};
+    ++mSize;
+    return handle;
+}
+
+void vgl::BoundingVolumeHierarchy::remove(Handle handle)
+{
+    if (handle >= mObjects.size() || !mObjects[handle].alive) {
+        return;
+    }
+    Object& object = mObjects[handle];
+    removeLeaf(object.node);
+    freeNode(object.node);
+    object.alive = false;
+    object.node = InvalidNode;
+    --mSize;
+
+    // the tree being built in the background may still contain a leaf with this handle
+    if (mRebuild.valid()) {
+        mPendingFreeHandles.push_back(handle);
+    } else {
+        mFreeHandles.push_back(handle);
+    }
+}
+
+void vgl::BoundingVolumeHierarchy::move(Handle handle, const Bounds &bounds)
+{
+    if (handle >= mObjects.size() || !mObjects[handle].alive) {
+        return;
+    }
+    Object& object = mObjects[handle];
+    object.min = bounds.min;
+    object.max = bounds.max;
+    if (!object.moved) {
+        object.moved = true;
+        mMoved.push_back(handle);
+    }
+}
+
+void vgl::BoundingVolumeHierarchy::update()
+{
+    if (mRebuild.valid() && mRebuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        adopt(mRebuild.get());
+    }
+
+    for (Handle handle : mMoved) {
+        Object& object = mObjects[handle];
+        object.moved = false;
+        if (!object.alive) {
+            continue;
+        }
+        Node& leaf = mNodes[object.node];
+        leaf.min = object.min;
+        leaf.max = object.max;
+        refitFrom(leaf.parent);
+    }
+    mMoved.clear();
+
+    if (++mUpdatesSinceCostCheck < internal::_bvhCostCheckInterval) {
+        return;
+    }
+    mUpdatesSinceCostCheck = 0;
+    mCost = cost();
+    if (!mRebuild.valid() && mSize > 1 && degradation() > mRebuildThreshold) {
+        mRebuild = std::async(std::launch::async, &BoundingVolumeHierarchy::build, primitives());
+    }
+}
+
+void vgl::BoundingVolumeHierarchy::rebuild()
+{
+    if (mRebuild.valid()) {
+        adopt(mRebuild.get());
+    }
+    adopt(build(primitives()));
+}
+
+void vgl::BoundingVolumeHierarchy::query(const Frustum &frustum, std::vector<std::uint32_t> &inside, std::vector<std::uint32_t> &intersecting) const
+{
+    inside.clear();
+    intersecting.clear();
+    if (mRoot == InvalidNode) {
+        return;
+    }
+
+    std::vector<std::uint32_t> stack{mRoot};
+    std::vector<std::uint32_t> subtree;
+    while (!stack.empty()) {
+        std::uint32_t index = stack.back();
+        const Node& node = mNodes[index];
+        stack.pop_back();
+
+        Intersection intersection = frustum.intersect(node.min, node.max);
+        if (intersection == Intersection::Outside) {
+            continue;
+        }
+
+        if (intersection == Intersection::Inside) {
+            // everything below is visible without further tests
+            subtree.push_back(index);
+            while (!subtree.empty()) {
+                const Node& child = mNodes[subtree.back()];
+                subtree.pop_back();
+                if (child.leaf()) {
+                    inside.push_back(mObjects[child.handle].value);
+                } else {
+                    subtree.push_back(child.left);
+                    subtree.push_back(child.right);
+                }
+            }
+        } else if (node.leaf()) {
+            intersecting.push_back(mObjects[node.handle].value);
+        } else {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+}
+
+GLfloat vgl::BoundingVolumeHierarchy::degradation() const
+{
+    // trees grown only by insertion have no build cost to compare against
+    if (mBuildCost < 0.0f) {
+        return std::numeric_limits<GLfloat>::max();
+    }
+    return mBuildCost > 0.0f ? mCost / mBuildCost : 1.0f;
+}
+
+void vgl::BoundingVolumeHierarchy::setRebuildThreshold(GLfloat threshold)
+{
+    mRebuildThreshold = threshold;
+}
+
+GLfloat vgl::BoundingVolumeHierarchy::rebuildThreshold() const
+{
+    return mRebuildThreshold;
+}
+
+std::size_t vgl::BoundingVolumeHierarchy::size() const
+{
+    return mSize;
+}
+
+bool vgl::BoundingVolumeHierarchy::rebuilding() const
+{
+    return mRebuild.valid();
+}
+
+bool vgl::BoundingVolumeHierarchy::Node::leaf() const
+{
+    return left == InvalidNode;
+}
+
+vgl::BoundingVolumeHierarchy::Tree vgl::BoundingVolumeHierarchy::build(std::vector<Primitive> primitives)
+{
+    Tree tree;
+    if (primitives.empty()) {
+        return tree;
+    }
+    tree.nodes.reserve(2 * primitives.size() - 1);
+    tree.root = buildRecursive(tree, primitives, 0, primitives.size(), InvalidNode, 0);
+    return tree;
+}
+
+std::uint32_t vgl::BoundingVolumeHierarchy::buildRecursive(Tree &tree, std::vector<Primitive> &primitives, std::size_t first, std::size_t last,
+                                                           std::uint32_t parent, std::size_t depth)
+{
+    using internal::grow;
+    using internal::surfaceArea;
+
+    std::uint32_t index = static_cast<std::uint32_t>(tree.nodes.size());
+    tree.nodes.emplace_back();
+    tree.nodes[index].parent = parent;
+
+    internal::Box box = internal::emptyBox();
+    internal::Box centroids = internal::emptyBox();
+    for (std::size_t i = first; i < last; ++i) {
+        grow(box[0], box[1], primitives[i].min, primitives[i].max);
+        grow(centroids[0], centroids[1], primitives[i].centroid, primitives[i].centroid);
+    }
+    tree.nodes[index].min = box[0];
+    tree.nodes[index].max = box[1];
+
+    if (last - first == 1) {
+        tree.nodes[index].handle = primitives[first].handle;
+        return index;
+    }
+
+    // binned surface area heuristic over all three axes
+    std::size_t bestAxis = 0;
+    std::size_t bestSplit = 0;
+    GLfloat bestCost = std::numeric_limits<GLfloat>::max();
+    auto binOf = [&centroids](const Primitive& primitive, std::size_t axis) {
+        GLfloat extent = centroids[1][axis] - centroids[0][axis];
+        std::size_t bin = static_cast<std::size_t>((primitive.centroid[axis] - centroids[0][axis]) / extent * internal::_bvhBinCount);
+        return std::min(bin, internal::_bvhBinCount - 1);
+    };
+
+    if (depth < internal::_bvhMaxSahDepth) {
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            if (centroids[1][axis] <= centroids[0][axis]) {
+                continue;
+            }
+
+            std::array<internal::Box, internal::_bvhBinCount> bins;
+            std::array<std::size_t, internal::_bvhBinCount> counts{};
+            bins.fill(internal::emptyBox());
+            for (std::size_t i = first; i < last; ++i) {
+                std::size_t bin = binOf(primitives[i], axis);
+                grow(bins[bin][0], bins[bin][1], primitives[i].min, primitives[i].max);
+                ++counts[bin];
+            }
+
+            // areas and counts of everything right of each split plane
+            std::array<GLfloat, internal::_bvhBinCount> rightArea{};
+            std::array<std::size_t, internal::_bvhBinCount> rightCount{};
+            internal::Box right = internal::emptyBox();
+            std::size_t count = 0;
+            for (std::size_t bin = internal::_bvhBinCount - 1; bin > 0; --bin) {
+                grow(right[0], right[1], bins[bin][0], bins[bin][1]);
+                count += counts[bin];
+                rightArea[bin] = count > 0 ? surfaceArea(right[0], right[1]) : 0.0f;
+                rightCount[bin] = count;
+            }
+
+            internal::Box left = internal::emptyBox();
+            count = 0;
+            for (std::size_t split = 1; split < internal::_bvhBinCount; ++split) {
+                grow(left[0], left[1], bins[split - 1][0], bins[split - 1][1]);
+                count += counts[split - 1];
+                if (count == 0 || rightCount[split] == 0) {
+                    continue;
+                }
+                GLfloat cost = surfaceArea(left[0], left[1]) * count + rightArea[split] * rightCount[split];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = split;
+                }
+            }
+        }
+    }
+
+    std::size_t middle;
+    if (bestSplit > 0) {
+        auto it = std::partition(primitives.begin() + first, primitives.begin() + last,
+            [&](const Primitive& primitive) { return binOf(primitive, bestAxis) < bestSplit; });
+        middle = static_cast<std::size_t>(it - primitives.begin());
+    } else {
+        // coincident centroids or too deep, split at the median of the widest axis
+        std::size_t axis = 0;
+        for (std::size_t i = 1; i < 3; ++i) {
+            if (centroids[1][i] - centroids[0][i] > centroids[1][axis] - centroids[0][axis]) {
+                axis = i;
+            }
+        }
+        middle = first + (last - first) / 2;
+        std::nth_element(primitives.begin() + first, primitives.begin() + middle, primitives.begin() + last,
+            [axis](const Primitive& a, const Primitive& b) { return a.centroid[axis] < b.centroid[axis]; });
+    }
+
+    std::uint32_t left = buildRecursive(tree, primitives, first, middle, index, depth + 1);
+    std::uint32_t right = buildRecursive(tree, primitives, middle, last, index, depth + 1);
+    tree.nodes[index].left = left;
+    tree.nodes[index].right = right;
+    return index;
+}
+
+std::vector<vgl::BoundingVolumeHierarchy::Primitive> vgl::BoundingVolumeHierarchy::primitives() const
+{
+    std::vector<Primitive> primitives;
+    primitives.reserve(mSize);
+    for (std::size_t handle = 0; handle < mObjects.size(); ++handle) {
+        const Object& object = mObjects[handle];
+        if (!object.alive) {
+            continue;
+        }
+        Primitive primitive{static_cast<Handle>(handle), object.min, object.max, {}};
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            primitive.centroid[axis] = 0.5f * (object.min[axis] + object.max[axis]);
+        }
+        primitives.push_back(primitive);
+    }
+    return primitives;
+}
+
+void vgl::BoundingVolumeHierarchy::adopt(Tree tree)
+{
+    mNodes = std::move(tree.nodes);
+    mRoot = tree.root;
+    mFreeNodes.clear();
+
+    for (Object& object : mObjects) {
+        object.node = InvalidNode;
+    }
+
+    // objects have moved since the snapshot, refit everything from the bottom up
+    std::vector<std::uint32_t> removed;
+    for (std::size_t i = mNodes.size(); i-- > 0;) {
+        Node& node = mNodes[i];
+        if (node.leaf()) {
+            Object& object = mObjects[node.handle];
+            if (object.alive) {
+                object.node = static_cast<std::uint32_t>(i);
+                node.min = object.min;
+                node.max = object.max;
+            } else {
+                removed.push_back(static_cast<std::uint32_t>(i));
+            }
+        } else {
+            node.min = mNodes[node.left].min;
+            node.max = mNodes[node.left].max;
+            internal::grow(node.min, node.max, mNodes[node.right].min, mNodes[node.right].max);
+        }
+    }
+
+    for (std::uint32_t leaf : removed) {
+        removeLeaf(leaf);
+        freeNode(leaf);
+    }
+
+    // objects inserted since the snapshot
+    for (std::size_t handle = 0; handle < mObjects.size(); ++handle) {
+        Object& object = mObjects[handle];
+        if (object.alive && object.node == InvalidNode) {
+            std::uint32_t leaf = allocateNode();
+            mNodes[leaf].min = object.min;
+            mNodes[leaf].max = object.max;
+            mNodes[leaf].handle = static_cast<Handle>(handle);
+            insertLeaf(leaf);
+            object.node = leaf;
+        }
+    }
+
+    mFreeHandles.insert(mFreeHandles.end(), mPendingFreeHandles.begin(), mPendingFreeHandles.end());
+    mPendingFreeHandles.clear();
+
+    mCost = cost();
+    mBuildCost = mCost;
+    mUpdatesSinceCostCheck = 0;
+}
+
+std::uint32_t vgl::BoundingVolumeHierarchy::allocateNode()
+{
+    if (!mFreeNodes.empty()) {
+        std::uint32_t node = mFreeNodes.back();
+        mFreeNodes.pop_back();
+        mNodes[node] = Node{};
+        return node;
+    }
+    mNodes.emplace_back();
+    return static_cast<std::uint32_t>(mNodes.size() - 1);
+}
+
+void vgl::BoundingVolumeHierarchy::freeNode(std::uint32_t node)
+{
+    mNodes[node] = Node{};
+    mFreeNodes.push_back(node);
+}
+
+void vgl::BoundingVolumeHierarchy::insertLeaf(std::uint32_t leaf)
+{
+    using internal::surfaceArea;
+
+    if (mRoot == InvalidNode) {
+        mRoot = leaf;
+        mNodes[leaf].parent = InvalidNode;
+        return;
+    }
+
+    // descend towards the child whose box grows the least, as in Box2D
+    const std::array<GLfloat, 3> leafMin = mNodes[leaf].min;
+    const std::array<GLfloat, 3> leafMax = mNodes[leaf].max;
+    auto combinedArea = [&](const Node& node) {
+        std::array<GLfloat, 3> min = node.min;
+        std::array<GLfloat, 3> max = node.max;
+        internal::grow(min, max, leafMin, leafMax);
+        return surfaceArea(min, max);
+    };
+
+    std::uint32_t sibling = mRoot;
+    while (!mNodes[sibling].leaf()) {
+        const Node& node = mNodes[sibling];
+        GLfloat area = surfaceArea(node.min, node.max);
+        GLfloat combined = combinedArea(node);
+
+        // pairing with this node versus pushing the leaf further down
+        GLfloat cost = 2.0f * combined;
+        GLfloat inheritance = 2.0f * (combined - area);
+        auto childCost = [&](const Node& child) {
+            GLfloat growth = combinedArea(child);
+            return (child.leaf() ? growth : growth - surfaceArea(child.min, child.max)) + inheritance;
+        };
+        GLfloat leftCost = childCost(mNodes[node.left]);
+        GLfloat rightCost = childCost(mNodes[node.right]);
+
+        if (cost < leftCost && cost < rightCost) {
+            break;
+        }
+        sibling = leftCost < rightCost ? node.left : node.right;
+    }
+
+    std::uint32_t oldParent = mNodes[sibling].parent;
+    std::uint32_t newParent = allocateNode();
+    mNodes[newParent].parent = oldParent;
+    mNodes[newParent].left = sibling;
+    mNodes[newParent].right = leaf;
+    mNodes[newParent].min = mNodes[sibling].min;
+    mNodes[newParent].max = mNodes[sibling].max;
+    internal::grow(mNodes[newParent].min, mNodes[newParent].max, leafMin, leafMax);
+    mNodes[sibling].parent = newParent;
+    mNodes[leaf].parent = newParent;
+
+    if (oldParent == InvalidNode) {
+        mRoot = newParent;
+        return;
+    }
+    if (mNodes[oldParent].left == sibling) {
+        mNodes[oldParent].left = newParent;
+    } else {
+        mNodes[oldParent].right = newParent;
+    }
+    refitFrom(oldParent);
+}
+
+void vgl::BoundingVolumeHierarchy::removeLeaf(std::uint32_t leaf)
+{
+    if (leaf == mRoot) {
+        mRoot = InvalidNode;
+        return;
+    }
+
+    std::uint32_t parent = mNodes[leaf].parent;
+    std::uint32_t grandParent = mNodes[parent].parent;
+    std::uint32_t sibling = mNodes[parent].left == leaf ? mNodes[parent].right : mNodes[parent].left;
+
+    // the sibling takes the place of the parent
+    mNodes[sibling].parent = grandParent;
+    freeNode(parent);
+    if (grandParent == InvalidNode) {
+        mRoot = sibling;
+        return;
+    }
+    if (mNodes[grandParent].left == parent) {
+        mNodes[grandParent].left = sibling;
+    } else {
+        mNodes[grandParent].right = sibling;
+    }
+    refitFrom(grandParent);
+}
+
+void vgl::BoundingVolumeHierarchy::refitFrom(std::uint32_t node)
+{
+    while (node != InvalidNode) {
+        Node& current = mNodes[node];
+        std::array<GLfloat, 3> min = mNodes[current.left].min;
+        std::array<GLfloat, 3> max = mNodes[current.left].max;
+        internal::grow(min, max, mNodes[current.right].min, mNodes[current.right].max);
+        if (min == current.min && max == current.max) {
+            return;
+        }
+        current.min = min;
+        current.max = max;
+        node = current.parent;
+    }
+}
+
+GLfloat vgl::BoundingVolumeHierarchy::cost() const
+{
+    if (mRoot == InvalidNode || mNodes[mRoot].leaf()) {
+        return 0.0f;
+    }
+
+    // sum of the surface areas of the inner nodes relative to the root
+    GLfloat rootArea = internal::surfaceArea(mNodes[mRoot].min, mNodes[mRoot].max);
+    if (rootArea <= 0.0f) {
+        return 0.0f;
+    }
+    GLfloat area = 0.0f;
+    std::vector<std::uint32_t> stack{mRoot};
+    while (!stack.empty()) {
+        const Node& node = mNodes[stack.back()];
+        stack.pop_back();
+        if (!node.leaf()) {
+            area += internal::surfaceArea(node.min, node.max);
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+    return area / rootArea;
+}
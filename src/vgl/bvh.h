@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <future>
+#include <vector>
+#include <vgl/gl.h>
+#include <vgl/culling.h>
+
+
+namespace vgl {
+
+// ===============================================================================================================
+// BoundingVolumeHierarchy
+// ===============================================================================================================
+// dynamic binary AABB tree with one leaf per object, built with the binned surface area heuristic,
+// refit incrementally when objects move and rebuilt in the background once refitting has degraded it
+class BoundingVolumeHierarchy {
+public:
+    using Handle = std::uint32_t;
+    static constexpr Handle InvalidHandle = ~Handle(0);
+
+    BoundingVolumeHierarchy() = default;
+    BoundingVolumeHierarchy(const BoundingVolumeHierarchy&) = delete;
+    BoundingVolumeHierarchy& operator=(const BoundingVolumeHierarchy&) = delete;
+    ~BoundingVolumeHierarchy();
+
+    // value is what query() reports for the object
+    Handle insert(const Bounds& bounds, std::uint32_t value);
+    void remove(Handle handle);
+    // the tree is refit by the next update()
+    void move(Handle handle, const Bounds& bounds);
+
+    // refits the ancestors of moved objects, swaps in a finished background rebuild
+    // and starts a new one if the cost has grown past the rebuild threshold
+    void update();
+    // synchronous full rebuild
+    void rebuild();
+
+    // values of the objects whose nodes are fully inside the frustum and of those that still need an exact test,
+    // both vectors are cleared first
+    void query(const Frustum& frustum, std::vector<std::uint32_t>& inside, std::vector<std::uint32_t>& intersecting) const;
+
+    // surface area heuristic cost relative to the cost right after the last build
+    GLfloat degradation() const;
+    void setRebuildThreshold(GLfloat threshold);
+    GLfloat rebuildThreshold() const;
+
+    std::size_t size() const;
+    bool rebuilding() const;
+
+private:
+    static constexpr std::uint32_t InvalidNode = ~std::uint32_t(0);
+
+    struct Node {
+        std::array<GLfloat, 3> min{};
+        std::array<GLfloat, 3> max{};
+        std::uint32_t parent = InvalidNode;
+        std::uint32_t left = InvalidNode;
+        std::uint32_t right = InvalidNode;
+        // leaves only
+        Handle handle = InvalidHandle;
+
+        bool leaf() const;
+    };
+
+    struct Object {
+        std::array<GLfloat, 3> min{};
+        std::array<GLfloat, 3> max{};
+        std::uint32_t value = 0;
+        std::uint32_t node = InvalidNode;
+        bool alive = false;
+        bool moved = false;
+    };
+
+    struct Primitive {
+        Handle handle;
+        std::array<GLfloat, 3> min;
+        std::array<GLfloat, 3> max;
+        std::array<GLfloat, 3> centroid;
+    };
+
+    struct Tree {
+        std::vector<Node> nodes{};
+        std::uint32_t root = InvalidNode;
+    };
+
+    // children are always stored after their parent
+    static Tree build(std::vector<Primitive> primitives);
+    static std::uint32_t buildRecursive(Tree& tree, std::vector<Primitive>& primitives, std::size_t first, std::size_t last,
+                                        std::uint32_t parent, std::size_t depth);
+
+    std::vector<Primitive> primitives() const;
+    void adopt(Tree tree);
+
+    std::uint32_t allocateNode();
+    void freeNode(std::uint32_t node);
+    void insertLeaf(std::uint32_t leaf);
+    void removeLeaf(std::uint32_t leaf);
+    // recomputes the boxes from node up to the root, stopping once a box does not change
+    void refitFrom(std::uint32_t node);
+
+    GLfloat cost() const;
+
+private:
+    std::vector<Object> mObjects{};
+    std::vector<Handle> mFreeHandles{};
+    // handles removed during a background rebuild, reused once it has been swapped in
+    std::vector<Handle> mPendingFreeHandles{};
+    std::vector<Handle> mMoved{};
+
+    std::vector<Node> mNodes{};
+    std::vector<std::uint32_t> mFreeNodes{};
+    std::uint32_t mRoot = InvalidNode;
+
+    // negative until the first build
+    GLfloat mBuildCost = -1.0f;
+    GLfloat mCost = 0.0f;
+    GLfloat mRebuildThreshold = 1.5f;
+    std::size_t mUpdatesSinceCostCheck = 0;
+    std::size_t mSize = 0;
+
+    std::future<Tree> mRebuild{};
+};
+
+} // namespace vgl
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+namespace vgl {
+
+// ===============================================================================================================
+// CommandQueue
+// ===============================================================================================================
+// bounded lock free queue for any number of producers and one consumer. Every slot carries a sequence number
+// telling whether it is free for the producer that claimed its position or filled for the consumer, so
+// producers only compete for the tail and never wait for each other or the consumer
+template <typename T>
+class CommandQueue {
+public:
+    // rounded up to a power of two
+    explicit CommandQueue(std::size_t capacity);
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    std::size_t capacity() const;
+
+    // any thread, false if the queue is full
+    bool push(T value);
+    // consumer only, false if the queue is empty
+    bool pop(T& value);
+
+private:
+    struct Slot {
+        std::atomic<std::size_t> sequence{0};
+        T value{};
+    };
+
+    static std::size_t roundUp(std::size_t capacity);
+
+private:
+    std::vector<Slot> mSlots;
+    std::size_t mMask;
+
+    // on separate cache lines, producers keep writing the tail while the consumer moves the head
+    alignas(64) std::atomic<std::size_t> mTail{0};
+    alignas(64) std::size_t mHead = 0;
+};
+
+template <typename T>
+CommandQueue<T>::CommandQueue(std::size_t capacity)
+    : mSlots(roundUp(capacity)), mMask(mSlots.size() - 1)
+{
+    for (std::size_t i = 0; i < mSlots.size(); ++i) {
+        mSlots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+std::size_t CommandQueue<T>::capacity() const
+{
+    return mSlots.size();
+}
+
+template <typename T>
+bool CommandQueue<T>::push(T value)
+{
+    std::size_t position = mTail.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot& slot = mSlots[position & mMask];
+        std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+        if (difference == 0) {
+            if (mTail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                slot.value = std::move(value);
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (difference < 0) {
+            // the consumer has not freed the slot of the previous round yet
+            return false;
+        } else {
+            position = mTail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename T>
+bool CommandQueue<T>::pop(T &value)
+{
+    Slot& slot = mSlots[mHead & mMask];
+    if (slot.sequence.load(std::memory_order_acquire) != mHead + 1) {
+        return false;
+    }
+    value = std::move(slot.value);
+    slot.value = T{};
+    slot.sequence.store(mHead + mSlots.size(), std::memory_order_release);
+    ++mHead;
+    return true;
+}
+
+template <typename T>
+std::size_t CommandQueue<T>::roundUp(std::size_t capacity)
+{
+    std::size_t size = 2;
+    while (size < capacity) {
+        size *= 2;
+    }
+    return size;
+}
+
+} // namespace vgl
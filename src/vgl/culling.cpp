@@ -0,0 +1,340 @@
+#include <vgl/culling.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define VGL_CULLING_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VGL_CULLING_SSE2 1
+#endif
+
+
+namespace vgl::internal {
+    #if defined(VGL_CULLING_AVX)
+    constexpr std::size_t _cullingWidth = 8;
+    #elif defined(VGL_CULLING_SSE2)
+    constexpr std::size_t _cullingWidth = 4;
+    #else
+    constexpr std::size_t _cullingWidth = 1;
+    #endif
+} // namespace vgl::internal
+
+// ===============================================================================================================
+// Bounds
+// ===============================================================================================================
+
+bool vgl::Bounds::valid() const
+{
+    return radius >= 0.0f;
+}
+
+bool vgl::backfacing(const Bounds &bounds, const NormalCone &cone, const std::array<GLfloat, 3> &eye)
+{
+    // the cone test of meshoptimizer, conservative for every view point inside the sphere
+    GLfloat dx = bounds.center[0] - eye[0];
+    GLfloat dy = bounds.center[1] - eye[1];
+    GLfloat dz = bounds.center[2] - eye[2];
+    GLfloat distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+    return dx * cone.axis[0] + dy * cone.axis[1] + dz * cone.axis[2] >= cone.cutoff * distance + bounds.radius;
+}
+
+vgl::Bounds vgl::computeBounds(const GLfloat *vertices, GLsizei vertexCount)
+{
+    Bounds bounds;
+    if (vertices == nullptr || vertexCount < 3) {
+        return bounds;
+    }
+
+    bounds.min.fill(std::numeric_limits<GLfloat>::max());
+    bounds.max.fill(std::numeric_limits<GLfloat>::lowest());
+    for (GLsizei i = 0; i + 2 < vertexCount; i += 3) {
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            bounds.min[axis] = std::min(bounds.min[axis], vertices[i + axis]);
+            bounds.max[axis] = std::max(bounds.max[axis], vertices[i + axis]);
+        }
+    }
+
+    // centered on the box, which is tighter than the half diagonal as long as the corners are empty
+    GLfloat radiusSquared = 0.0f;
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        bounds.center[axis] = 0.5f * (bounds.min[axis] + bounds.max[axis]);
+    }
+    for (GLsizei i = 0; i + 2 < vertexCount; i += 3) {
+        GLfloat dx = vertices[i] - bounds.center[0];
+        GLfloat dy = vertices[i + 1] - bounds.center[1];
+        GLfloat dz = vertices[i + 2] - bounds.center[2];
+        radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+    }
+    bounds.radius = std::sqrt(radiusSquared);
+    return bounds;
+}
+
+vgl::Bounds vgl::transformBounds(const Bounds &bounds, const std::array<std::array<GLfloat, 4>, 4> &matrix)
+{
+    if (!bounds.valid()) {
+        return bounds;
+    }
+
+    Bounds result;
+    GLfloat maxScaleSquared = 0.0f;
+    for (std::size_t column = 0; column < 3; ++column) {
+        GLfloat scaleSquared = matrix[0][column] * matrix[0][column] + matrix[1][column] * matrix[1][column] + matrix[2][column] * matrix[2][column];
+        maxScaleSquared = std::max(maxScaleSquared, scaleSquared);
+    }
+    result.radius = bounds.radius * std::sqrt(maxScaleSquared);
+
+    // Arvo, transforming an axis aligned box
+    for (std::size_t row = 0; row < 3; ++row) {
+        result.center[row] = matrix[row][3];
+        result.min[row] = matrix[row][3];
+        result.max[row] = matrix[row][3];
+        for (std::size_t column = 0; column < 3; ++column) {
+            result.center[row] += matrix[row][column] * bounds.center[column];
+            GLfloat a = matrix[row][column] * bounds.min[column];
+            GLfloat b = matrix[row][column] * bounds.max[column];
+            result.min[row] += std::min(a, b);
+            result.max[row] += std::max(a, b);
+        }
+    }
+    return result;
+}
+
+// ===============================================================================================================
+// Frustum
+// ===============================================================================================================
+
+void vgl::Frustum::setViewProjection(const std::array<std::array<GLfloat, 4>, 4> &viewProjection)
+{
+    // Gribb and Hartmann, the planes are sums and differences of the last row with the others
+    const auto& m = viewProjection;
+    for (std::size_t row = 0; row < 3; ++row) {
+        for (std::size_t i = 0; i < 4; ++i) {
+            planes[2 * row][i] = m[3][i] + m[row][i];
+            planes[2 * row + 1][i] = m[3][i] - m[row][i];
+        }
+    }
+
+    for (auto& plane : planes) {
+        GLfloat length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        if (length > 0.0f) {
+            for (GLfloat& value : plane) {
+                value /= length;
+            }
+        }
+    }
+}
+
+vgl::Intersection vgl::Frustum::intersect(const std::array<GLfloat, 3> &min, const std::array<GLfloat, 3> &max) const
+{
+    Intersection result = Intersection::Inside;
+    for (const auto& plane : planes) {
+        // the corners furthest along and against the plane normal
+        GLfloat furthest = plane[3];
+        GLfloat nearest = plane[3];
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            furthest += plane[axis] * (plane[axis] >= 0.0f ? max[axis] : min[axis]);
+            nearest += plane[axis] * (plane[axis] >= 0.0f ? min[axis] : max[axis]);
+        }
+        if (furthest < 0.0f) {
+            return Intersection::Outside;
+        }
+        if (nearest < 0.0f) {
+            result = Intersection::Intersecting;
+        }
+    }
+    return result;
+}
+
+vgl::Intersection vgl::Frustum::intersect(const std::array<GLfloat, 3> &center, GLfloat radius) const
+{
+    Intersection result = Intersection::Inside;
+    for (const auto& plane : planes) {
+        GLfloat distance = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+        if (distance < -radius) {
+            return Intersection::Outside;
+        }
+        if (distance < radius) {
+            result = Intersection::Intersecting;
+        }
+    }
+    return result;
+}
+
+vgl::Frustum vgl::Frustum::transformed(const std::array<std::array<GLfloat, 4>, 4> &model) const
+{
+    // a world space point p = M x is in front of a plane if plane * M * x >= 0
+    Frustum result;
+    for (std::size_t i = 0; i < planes.size(); ++i) {
+        for (std::size_t column = 0; column < 4; ++column) {
+            result.planes[i][column] = planes[i][3] * (column == 3 ? 1.0f : 0.0f);
+            for (std::size_t row = 0; row < 3; ++row) {
+                result.planes[i][column] += planes[i][row] * model[row][column];
+            }
+        }
+        GLfloat length = std::sqrt(result.planes[i][0] * result.planes[i][0] + result.planes[i][1] * result.planes[i][1]
+            + result.planes[i][2] * result.planes[i][2]);
+        if (length > 0.0f) {
+            for (GLfloat& value : result.planes[i]) {
+                value /= length;
+            }
+        }
+    }
+    return result;
+}
+
+// ===============================================================================================================
+// FrustumCuller
+// ===============================================================================================================
+
+void vgl::FrustumCuller::setFrustum(const Frustum &frustum)
+{
+    mFrustum = frustum;
+}
+
+void vgl::FrustumCuller::clear()
+{
+    mCount = 0;
+}
+
+std::uint32_t vgl::FrustumCuller::add(const Bounds &bounds)
+{
+    // drops the padding of the last cull()
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        mCenter[axis].resize(mCount);
+        mMin[axis].resize(mCount);
+        mMax[axis].resize(mCount);
+    }
+    mRadius.resize(mCount);
+
+    if (bounds.valid()) {
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            mCenter[axis].push_back(bounds.center[axis]);
+            mMin[axis].push_back(bounds.min[axis]);
+            mMax[axis].push_back(bounds.max[axis]);
+        }
+        mRadius.push_back(bounds.radius);
+    } else {
+        // large enough to pass every plane, but finite so that zero plane components do not produce NaNs
+        constexpr GLfloat max = std::numeric_limits<GLfloat>::max();
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            mCenter[axis].push_back(0.0f);
+            mMin[axis].push_back(-max);
+            mMax[axis].push_back(max);
+        }
+        mRadius.push_back(max);
+    }
+    return static_cast<std::uint32_t>(mCount++);
+}
+
+const std::vector<std::uint32_t>& vgl::FrustumCuller::cull()
+{
+    mVisible.clear();
+
+    std::size_t padded = (mCount + internal::_cullingWidth - 1) / internal::_cullingWidth * internal::_cullingWidth;
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        mCenter[axis].resize(padded, 0.0f);
+        mMin[axis].resize(padded, 0.0f);
+        mMax[axis].resize(padded, 0.0f);
+    }
+    mRadius.resize(padded, 0.0f);
+
+    std::size_t first = 0;
+
+    #if defined(VGL_CULLING_AVX)
+    for (; first < padded; first += 8) {
+        __m256 cx = _mm256_loadu_ps(mCenter[0].data() + first);
+        __m256 cy = _mm256_loadu_ps(mCenter[1].data() + first);
+        __m256 cz = _mm256_loadu_ps(mCenter[2].data() + first);
+        __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(mRadius.data() + first));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (const auto& plane : mFrustum.planes) {
+            __m256 nx = _mm256_set1_ps(plane[0]);
+            __m256 ny = _mm256_set1_ps(plane[1]);
+            __m256 nz = _mm256_set1_ps(plane[2]);
+            __m256 d = _mm256_set1_ps(plane[3]);
+
+            __m256 sphere = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, cx), _mm256_mul_ps(ny, cy)), _mm256_add_ps(_mm256_mul_ps(nz, cz), d));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(sphere, negativeRadius, _CMP_GE_OQ));
+
+            // the box corner furthest along the plane normal
+            __m256 px = _mm256_loadu_ps((plane[0] >= 0.0f ? mMax[0] : mMin[0]).data() + first);
+            __m256 py = _mm256_loadu_ps((plane[1] >= 0.0f ? mMax[1] : mMin[1]).data() + first);
+            __m256 pz = _mm256_loadu_ps((plane[2] >= 0.0f ? mMax[2] : mMin[2]).data() + first);
+            __m256 box = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, px), _mm256_mul_ps(ny, py)), _mm256_add_ps(_mm256_mul_ps(nz, pz), d));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(box, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        for (std::size_t lane = 0; mask != 0 && lane < 8; ++lane, mask >>= 1) {
+            if ((mask & 1) != 0 && first + lane < mCount) {
+                mVisible.push_back(static_cast<std::uint32_t>(first + lane));
+            }
+        }
+    }
+    #elif defined(VGL_CULLING_SSE2)
+    for (; first < padded; first += 4) {
+        __m128 cx = _mm_loadu_ps(mCenter[0].data() + first);
+        __m128 cy = _mm_loadu_ps(mCenter[1].data() + first);
+        __m128 cz = _mm_loadu_ps(mCenter[2].data() + first);
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(mRadius.data() + first));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (const auto& plane : mFrustum.planes) {
+            __m128 nx = _mm_set1_ps(plane[0]);
+            __m128 ny = _mm_set1_ps(plane[1]);
+            __m128 nz = _mm_set1_ps(plane[2]);
+            __m128 d = _mm_set1_ps(plane[3]);
+
+            __m128 sphere = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_add_ps(_mm_mul_ps(nz, cz), d));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(sphere, negativeRadius));
+
+            // the box corner furthest along the plane normal
+            __m128 px = _mm_loadu_ps((plane[0] >= 0.0f ? mMax[0] : mMin[0]).data() + first);
+            __m128 py = _mm_loadu_ps((plane[1] >= 0.0f ? mMax[1] : mMin[1]).data() + first);
+            __m128 pz = _mm_loadu_ps((plane[2] >= 0.0f ? mMax[2] : mMin[2]).data() + first);
+            __m128 box = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, px), _mm_mul_ps(ny, py)), _mm_add_ps(_mm_mul_ps(nz, pz), d));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(box, _mm_setzero_ps()));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (std::size_t lane = 0; mask != 0 && lane < 4; ++lane, mask >>= 1) {
+            if ((mask & 1) != 0 && first + lane < mCount) {
+                mVisible.push_back(static_cast<std::uint32_t>(first + lane));
+            }
+        }
+    }
+    #endif
+
+    cullScalar(first);
+    return mVisible;
+}
+
+std::size_t vgl::FrustumCuller::size() const
+{
+    return mCount;
+}
+
+void vgl::FrustumCuller::cullScalar(std::size_t first)
+{
+    for (std::size_t i = first; i < mCount; ++i) {
+        bool inside = true;
+        for (const auto& plane : mFrustum.planes) {
+            GLfloat sphere = plane[0] * mCenter[0][i] + plane[1] * mCenter[1][i] + plane[2] * mCenter[2][i] + plane[3];
+            GLfloat box = plane[0] * (plane[0] >= 0.0f ? mMax[0][i] : mMin[0][i])
+                + plane[1] * (plane[1] >= 0.0f ? mMax[1][i] : mMin[1][i])
+                + plane[2] * (plane[2] >= 0.0f ? mMax[2][i] : mMin[2][i]) + plane[3];
+            if (sphere < -mRadius[i] || box < 0.0f) {
+                inside = false;
+                break;
+            }
+        }
+        if (inside) {
+            mVisible.push_back(static_cast<std::uint32_t>(i));
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <vgl/gl.h>
+
+
+namespace vgl {
+
+// ===============================================================================================================
+// Bounds
+// ===============================================================================================================
+// bounding sphere and axis aligned bounding box
+struct Bounds {
+    std::array<GLfloat, 3> center{0.0f, 0.0f, 0.0f};
+    // negative if the bounds have not been computed
+    GLfloat radius = -1.0f;
+
+    std::array<GLfloat, 3> min{0.0f, 0.0f, 0.0f};
+    std::array<GLfloat, 3> max{0.0f, 0.0f, 0.0f};
+
+    bool valid() const;
+};
+
+// normal cone of a cluster of triangles, see buildMeshlets(). cutoff is the sine of the largest angle between
+// the axis and a triangle normal, 1 if the normals spread too far for the cone to ever cull
+struct NormalCone {
+    std::array<GLfloat, 3> axis{0.0f, 0.0f, 0.0f};
+    GLfloat cutoff = 1.0f;
+};
+
+// true if every triangle of a cluster inside the sphere of bounds faces away from the eye
+bool backfacing(const Bounds& bounds, const NormalCone& cone, const std::array<GLfloat, 3>& eye);
+
+// vertexCount is the number of floats, 3 per vertex, like in MeshData
+Bounds computeBounds(const GLfloat* vertices, GLsizei vertexCount);
+
+// bounds of the geometry after transformation with an affine row major matrix,
+// the sphere grows with the largest scale, the box encloses the transformed box
+Bounds transformBounds(const Bounds& bounds, const std::array<std::array<GLfloat, 4>, 4>& matrix);
+
+// ===============================================================================================================
+// Frustum
+// ===============================================================================================================
+enum class Intersection {
+    Outside,
+    Intersecting,
+    Inside
+};
+
+struct Frustum {
+    // normalized, pointing inwards: left, right, bottom, top, near, far
+    std::array<std::array<GLfloat, 4>, 6> planes{};
+
+    // the planes are extracted from the row major projection * view matrix
+    void setViewProjection(const std::array<std::array<GLfloat, 4>, 4>& viewProjection);
+
+    Intersection intersect(const std::array<GLfloat, 3>& min, const std::array<GLfloat, 3>& max) const;
+    Intersection intersect(const std::array<GLfloat, 3>& center, GLfloat radius) const;
+
+    // the planes in the object space of an affine row major model matrix, spheres keep their shape there
+    Frustum transformed(const std::array<std::array<GLfloat, 4>, 4>& model) const;
+};
+
+// ===============================================================================================================
+// FrustumCuller
+// ===============================================================================================================
+// tests world space bounds against the six planes of the view frustum,
+// 8 bounds per iteration with AVX, 4 with SSE2 and one at a time otherwise
+class FrustumCuller {
+public:
+    void setFrustum(const Frustum& frustum);
+
+    void clear();
+    // returns the index of the bounds, invalid bounds are never culled
+    std::uint32_t add(const Bounds& bounds);
+
+    // indices of the bounds intersecting the frustum, in the order they were added
+    const std::vector<std::uint32_t>& cull();
+
+    std::size_t size() const;
+
+private:
+    void cullScalar(std::size_t first);
+
+private:
+    Frustum mFrustum{};
+
+    // structure of arrays, padded to a multiple of the SIMD width
+    std::array<std::vector<GLfloat>, 3> mCenter{};
+    std::vector<GLfloat> mRadius{};
+    std::array<std::vector<GLfloat>, 3> mMin{};
+    std::array<std::vector<GLfloat>, 3> mMax{};
+    std::size_t mCount = 0;
+
+    std::vector<std::uint32_t> mVisible{};
+};
+
+} // namespace vgl
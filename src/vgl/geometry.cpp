@@ -0,0 +1,966 @@
+#include <vgl/geometry.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <tuple>
+#include <vgl/renderer.h>
+
+
+namespace vgl::internal {
+    // the pools have to outlive the cache and its geometry
+    std::array<GeometryPool, static_cast<std::size_t>(GeometryFormat::Count)> _geometryPools = {
+        GeometryPool(GeometryFormat::Float),
+        GeometryPool(GeometryFormat::Quantized),
+        GeometryPool(GeometryFormat::Quantized16),
+        GeometryPool(GeometryFormat::Dynamic)};
+    GeometryCache _geometryCache;
+
+    constexpr std::size_t _initialPoolVertices = 1 << 16;
+    constexpr std::size_t _initialPoolIndices = 1 << 18;
+
+    GeometryPool& geometryPool(GeometryFormat format)
+    {
+        return _geometryPools[static_cast<std::size_t>(format)];
+    }
+
+    void waitForSync(GLsync sync)
+    {
+        GLenum result = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        while (result == GL_TIMEOUT_EXPIRED) {
+            result = glClientWaitSync(sync, 0, 1000000);
+        }
+    }
+
+    // blocks until all commands issued so far have finished
+    void finishCommands()
+    {
+        GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        waitForSync(sync);
+        glDeleteSync(sync);
+    }
+
+    // signed normalized 10 bit components, w = 0
+    GLuint packNormal(const GLfloat* normal)
+    {
+        GLuint packed = 0;
+        for (int i = 0; i < 3; ++i) {
+            GLfloat n = std::clamp(normal[i], -1.0f, 1.0f);
+            GLint value = static_cast<GLint>(std::lround(n * 511.0f));
+            packed |= (static_cast<GLuint>(value) & 0x3FFu) << (10 * i);
+        }
+        return packed;
+    }
+} // namespace vgl::internal
+
+// ===============================================================================================================
+// GeometryKey
+// ===============================================================================================================
+
+vgl::GeometryKey::GeometryKey(const MeshData &data)
+    : vertices(data.vertices), normals(data.normals), indices(data.indices), vertexCount(data.vertexCount), indexCount(data.indexCount),
+      quantize(data.quantize), dynamic(data.usage == GeometryUsage::Dynamic)
+{
+}
+
+bool vgl::GeometryKey::operator<(const GeometryKey &other) const
+{
+    return std::tie(vertices, normals, indices, vertexCount, indexCount, quantize, dynamic)
+        < std::tie(other.vertices, other.normals, other.indices, other.vertexCount, other.indexCount, other.quantize, other.dynamic);
+}
+
+bool vgl::GeometryKey::operator==(const GeometryKey &other) const
+{
+    return std::tie(vertices, normals, indices, vertexCount, indexCount, quantize, dynamic)
+        == std::tie(other.vertices, other.normals, other.indices, other.vertexCount, other.indexCount, other.quantize, other.dynamic);
+}
+
+// ===============================================================================================================
+// BufferAllocator
+// ===============================================================================================================
+
+vgl::BufferAllocator::BufferAllocator(std::size_t capacity)
+{
+    grow(capacity);
+}
+
+std::size_t vgl::BufferAllocator::allocate(std::size_t size)
+{
+    if (size == 0) {
+        return InvalidOffset;
+    }
+
+    auto bestFit = mFreeBySize.lower_bound(size);
+    if (bestFit == mFreeBySize.end()) {
+        return InvalidOffset;
+    }
+
+    std::size_t offset = bestFit->second;
+    std::size_t blockSize = bestFit->first;
+    eraseFreeBlock(mFreeByOffset.find(offset));
+    if (blockSize > size) {
+        insertFreeBlock(offset + size, blockSize - size);
+    }
+
+    mAllocations.emplace(offset, size);
+    mUsed += size;
+    return offset;
+}
+
+void vgl::BufferAllocator::free(std::size_t offset)
+{
+    auto it = mAllocations.find(offset);
+    if (it == mAllocations.end()) {
+        return;
+    }
+    std::size_t size = it->second;
+    mAllocations.erase(it);
+    mUsed -= size;
+
+    // coalesce with the neighbouring free blocks
+    auto next = mFreeByOffset.lower_bound(offset);
+    if (next != mFreeByOffset.end() && next->first == offset + size) {
+        size += next->second;
+        next = std::next(next);
+        eraseFreeBlock(std::prev(next));
+    }
+    if (next != mFreeByOffset.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            eraseFreeBlock(prev);
+        }
+    }
+    insertFreeBlock(offset, size);
+}
+
+void vgl::BufferAllocator::grow(std::size_t capacity)
+{
+    if (capacity <= mCapacity) {
+        return;
+    }
+
+    std::size_t offset = mCapacity;
+    std::size_t size = capacity - mCapacity;
+    mCapacity = capacity;
+
+    // extend a free block ending at the old capacity
+    if (!mFreeByOffset.empty()) {
+        auto last = std::prev(mFreeByOffset.end());
+        if (last->first + last->second == offset) {
+            offset = last->first;
+            size += last->second;
+            eraseFreeBlock(last);
+        }
+    }
+    insertFreeBlock(offset, size);
+}
+
+std::vector<vgl::BufferAllocator::Move> vgl::BufferAllocator::compact()
+{
+    std::vector<Move> moves;
+    std::map<std::size_t, std::size_t> allocations;
+
+    std::size_t offset = 0;
+    for (const auto& [from, size] : mAllocations) {
+        if (from != offset) {
+            moves.push_back(Move{from, offset, size});
+        }
+        allocations.emplace(offset, size);
+        offset += size;
+    }
+
+    mAllocations.swap(allocations);
+    mFreeByOffset.clear();
+    mFreeBySize.clear();
+    if (offset < mCapacity) {
+        insertFreeBlock(offset, mCapacity - offset);
+    }
+    return moves;
+}
+
+std::size_t vgl::BufferAllocator::capacity() const
+{
+    return mCapacity;
+}
+
+std::size_t vgl::BufferAllocator::used() const
+{
+    return mUsed;
+}
+
+std::size_t vgl::BufferAllocator::largestFreeBlock() const
+{
+    return mFreeBySize.empty() ? 0 : std::prev(mFreeBySize.end())->first;
+}
+
+void vgl::BufferAllocator::insertFreeBlock(std::size_t offset, std::size_t size)
+{
+    mFreeByOffset.emplace(offset, size);
+    mFreeBySize.emplace(size, offset);
+}
+
+void vgl::BufferAllocator::eraseFreeBlock(std::map<std::size_t, std::size_t>::iterator it)
+{
+    auto [first, last] = mFreeBySize.equal_range(it->second);
+    for (auto sizeIt = first; sizeIt != last; ++sizeIt) {
+        if (sizeIt->second == it->first) {
+            mFreeBySize.erase(sizeIt);
+            break;
+        }
+    }
+    mFreeByOffset.erase(it);
+}
+
+// ===============================================================================================================
+// DirtyRanges
+// ===============================================================================================================
+
+void vgl::DirtyRanges::add(std::size_t first, std::size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    mRanges.push_back(Range{first, first + count});
+    mCoalesced = mRanges.size() == 1;
+}
+
+void vgl::DirtyRanges::add(const DirtyRanges &other)
+{
+    if (other.mRanges.empty()) {
+        return;
+    }
+    mRanges.insert(mRanges.end(), other.mRanges.begin(), other.mRanges.end());
+    mCoalesced = false;
+}
+
+void vgl::DirtyRanges::clear()
+{
+    mRanges.clear();
+    mCoalesced = true;
+}
+
+bool vgl::DirtyRanges::empty() const
+{
+    return mRanges.empty();
+}
+
+const std::vector<vgl::DirtyRanges::Range> &vgl::DirtyRanges::coalesce()
+{
+    if (mCoalesced) {
+        return mRanges;
+    }
+    std::sort(mRanges.begin(), mRanges.end(), [](const Range& a, const Range& b) { return a.first < b.first; });
+
+    std::size_t merged = 0;
+    for (std::size_t i = 1; i < mRanges.size(); ++i) {
+        if (mRanges[i].first <= mRanges[merged].last) {
+            mRanges[merged].last = std::max(mRanges[merged].last, mRanges[i].last);
+        } else {
+            mRanges[++merged] = mRanges[i];
+        }
+    }
+    mRanges.resize(merged + 1);
+    mCoalesced = true;
+    return mRanges;
+}
+
+// ===============================================================================================================
+// GeometryPool
+// ===============================================================================================================
+
+vgl::GeometryPool::GeometryPool(GeometryFormat format)
+    : mFormat(format)
+{
+}
+
+vgl::GeometryPool::~GeometryPool()
+{
+    if (mVAO == 0) {
+        return;
+    }
+    for (GLsync fence : mFences) {
+        if (fence != nullptr) {
+            glDeleteSync(fence);
+        }
+    }
+    glDeleteVertexArrays(1, &mVAO);
+    glDeleteBuffers(1, &mVBO);
+    glDeleteBuffers(1, &mEBO);
+}
+
+vgl::GeometryPool::Handle vgl::GeometryPool::allocate(const void *vertices, std::size_t vertexCount, const void *indices, std::size_t indexCount)
+{
+    if (mVAO == 0) {
+        createGLObjects();
+    }
+
+    std::size_t copies = dynamic() ? FramesInFlight : 1;
+    std::size_t vertexOffset = allocateVertices(vertexCount * copies);
+    std::size_t indexOffset = allocateIndices(indexCount * copies);
+    if (vertexOffset == BufferAllocator::InvalidOffset || indexOffset == BufferAllocator::InvalidOffset) {
+        mVertexAllocator.free(vertexOffset);
+        mIndexAllocator.free(indexOffset);
+        return InvalidHandle;
+    }
+
+    if (dynamic()) {
+        // retired ranges are only reused once no frame in flight draws them, so they can be written right away
+        for (std::size_t copy = 0; copy < copies; ++copy) {
+            std::memcpy(static_cast<char*>(mVertexMapping) + (vertexOffset + copy * vertexCount) * vertexSize(), vertices, vertexCount * vertexSize());
+            std::memcpy(static_cast<char*>(mIndexMapping) + (indexOffset + copy * indexCount) * indexSize(), indices, indexCount * indexSize());
+        }
+    } else {
+        glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+        glBufferSubData(GL_ARRAY_BUFFER, vertexOffset * vertexSize(), vertexCount * vertexSize(), vertices);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // the element array binding is vertex array state
+        glBindVertexArray(mVAO);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexOffset * indexSize(), indexCount * indexSize(), indices);
+        glBindVertexArray(0);
+    }
+
+    Handle handle;
+    if (!mFreeHandles.empty()) {
+        handle = mFreeHandles.back();
+        mFreeHandles.pop_back();
+    } else {
+        handle = static_cast<Handle>(mAllocations.size());
+        mAllocations.emplace_back();
+    }
+    mAllocations[handle] = Allocation{vertexOffset, vertexCount, indexOffset, indexCount, true};
+    return handle;
+}
+
+void vgl::GeometryPool::free(Handle handle)
+{
+    if (handle >= mAllocations.size() || !mAllocations[handle].used) {
+        return;
+    }
+    if (dynamic()) {
+        mRetiredHandles.emplace_back(handle, mFrame);
+        return;
+    }
+    release(handle);
+}
+
+void vgl::GeometryPool::compact()
+{
+    if (mVAO == 0) {
+        return;
+    }
+    compactBuffer(mVBO, mVertexMapping, mVertexAllocator, vertexSize(), &Allocation::vertexOffset, &Allocation::vertexCount);
+    compactBuffer(mEBO, mIndexMapping, mIndexAllocator, indexSize(), &Allocation::indexOffset, &Allocation::indexCount);
+}
+
+void *vgl::GeometryPool::vertexData(Handle handle, std::size_t copy) const
+{
+    // the copies follow each other, vertexCount is the size of one
+    const Allocation& allocation = mAllocations[handle];
+    return static_cast<char*>(mVertexMapping) + (allocation.vertexOffset + copy * allocation.vertexCount) * vertexSize();
+}
+
+void *vgl::GeometryPool::indexData(Handle handle, std::size_t copy) const
+{
+    const Allocation& allocation = mAllocations[handle];
+    return static_cast<char*>(mIndexMapping) + (allocation.indexOffset + copy * allocation.indexCount) * indexSize();
+}
+
+bool vgl::GeometryPool::writeVertices(Handle handle, std::size_t first, const void *vertices, std::size_t count, std::size_t copy)
+{
+    // a range past the end would run into the next copy or allocation
+    if (first > mAllocations[handle].vertexCount || count > mAllocations[handle].vertexCount - first) {
+        return false;
+    }
+    if (dynamic()) {
+        std::memcpy(static_cast<char*>(vertexData(handle, copy)) + first * vertexSize(), vertices, count * vertexSize());
+        return true;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mVBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (mAllocations[handle].vertexOffset + first) * vertexSize(), count * vertexSize(), vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return true;
+}
+
+bool vgl::GeometryPool::writeIndices(Handle handle, std::size_t first, const void *indices, std::size_t count, std::size_t copy)
+{
+    if (first > mAllocations[handle].indexCount || count > mAllocations[handle].indexCount - first) {
+        return false;
+    }
+    if (dynamic()) {
+        std::memcpy(static_cast<char*>(indexData(handle, copy)) + first * indexSize(), indices, count * indexSize());
+        return true;
+    }
+    // not through GL_ELEMENT_ARRAY_BUFFER, which would need the vertex array bound
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mEBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (mAllocations[handle].indexOffset + first) * indexSize(), count * indexSize(), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return true;
+}
+
+bool vgl::GeometryPool::dynamic() const
+{
+    return mFormat == GeometryFormat::Dynamic;
+}
+
+std::uint64_t vgl::GeometryPool::frame() const
+{
+    return mFrame;
+}
+
+void vgl::GeometryPool::synchronize()
+{
+    if (mSynchronizedFrame == mFrame) {
+        return;
+    }
+    mSynchronizedFrame = mFrame;
+
+    // copies rotate once per written frame, so the copy written now was last drawn by frame - FramesInFlight,
+    // whose fence endFrame() left in the slot this frame reuses
+    GLsync& fence = mFences[mFrame % FramesInFlight];
+    if (fence != nullptr) {
+        internal::waitForSync(fence);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void vgl::GeometryPool::endFrame()
+{
+    if (mVAO == 0) {
+        return;
+    }
+
+    GLsync& fence = mFences[mFrame % FramesInFlight];
+    if (fence != nullptr) {
+        glDeleteSync(fence);
+    }
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ++mFrame;
+
+    auto end = std::remove_if(mRetiredHandles.begin(), mRetiredHandles.end(), [this](const auto& retired) {
+        if (retired.second + FramesInFlight > mFrame) {
+            return false;
+        }
+        release(retired.first);
+        return true;
+    });
+    mRetiredHandles.erase(end, mRetiredHandles.end());
+}
+
+vgl::GeometryPool::Range vgl::GeometryPool::range(Handle handle) const
+{
+    const Allocation& allocation = mAllocations[handle];
+    return Range{static_cast<GLint>(allocation.vertexOffset), static_cast<GLuint>(allocation.indexOffset)};
+}
+
+GLuint vgl::GeometryPool::vao() const
+{
+    return mVAO;
+}
+
+vgl::GeometryFormat vgl::GeometryPool::format() const
+{
+    return mFormat;
+}
+
+GLenum vgl::GeometryPool::indexType() const
+{
+    return mFormat == GeometryFormat::Quantized16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+std::size_t vgl::GeometryPool::vertexSize() const
+{
+    return mFormat == GeometryFormat::Float || mFormat == GeometryFormat::Dynamic ? sizeof(Vertex) : sizeof(QuantizedVertex);
+}
+
+std::size_t vgl::GeometryPool::indexSize() const
+{
+    return mFormat == GeometryFormat::Quantized16 ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+void vgl::GeometryPool::setInstanceBuffer(GLuint instanceVBO)
+{
+    if (instanceVBO == mInstanceVBO) {
+        return;
+    }
+    mInstanceVBO = instanceVBO;
+    setupVertexArray();
+}
+
+std::size_t vgl::GeometryPool::vertexCapacity() const
+{
+    return mVertexAllocator.capacity();
+}
+
+std::size_t vgl::GeometryPool::indexCapacity() const
+{
+    return mIndexAllocator.capacity();
+}
+
+std::size_t vgl::GeometryPool::usedVertices() const
+{
+    return mVertexAllocator.used();
+}
+
+std::size_t vgl::GeometryPool::usedIndices() const
+{
+    return mIndexAllocator.used();
+}
+
+std::size_t vgl::GeometryPool::allocateVertices(std::size_t count)
+{
+    std::size_t offset = mVertexAllocator.allocate(count);
+    if (offset != BufferAllocator::InvalidOffset) {
+        return offset;
+    }
+
+    // enough space, but fragmented
+    if (mVertexAllocator.capacity() - mVertexAllocator.used() >= count) {
+        compactBuffer(mVBO, mVertexMapping, mVertexAllocator, vertexSize(), &Allocation::vertexOffset, &Allocation::vertexCount);
+        offset = mVertexAllocator.allocate(count);
+        if (offset != BufferAllocator::InvalidOffset) {
+            return offset;
+        }
+    }
+
+    std::size_t oldCapacity = mVertexAllocator.capacity();
+    std::size_t newCapacity = std::max(2 * oldCapacity, oldCapacity + count);
+    resizeBuffer(mVBO, mVertexMapping, oldCapacity * vertexSize(), newCapacity * vertexSize());
+    mVertexAllocator.grow(newCapacity);
+    setupVertexArray();
+    return mVertexAllocator.allocate(count);
+}
+
+std::size_t vgl::GeometryPool::allocateIndices(std::size_t count)
+{
+    std::size_t offset = mIndexAllocator.allocate(count);
+    if (offset != BufferAllocator::InvalidOffset) {
+        return offset;
+    }
+
+    if (mIndexAllocator.capacity() - mIndexAllocator.used() >= count) {
+        compactBuffer(mEBO, mIndexMapping, mIndexAllocator, indexSize(), &Allocation::indexOffset, &Allocation::indexCount);
+        offset = mIndexAllocator.allocate(count);
+        if (offset != BufferAllocator::InvalidOffset) {
+            return offset;
+        }
+    }
+
+    std::size_t oldCapacity = mIndexAllocator.capacity();
+    std::size_t newCapacity = std::max(2 * oldCapacity, oldCapacity + count);
+    resizeBuffer(mEBO, mIndexMapping, oldCapacity * indexSize(), newCapacity * indexSize());
+    mIndexAllocator.grow(newCapacity);
+    setupVertexArray();
+    return mIndexAllocator.allocate(count);
+}
+
+void vgl::GeometryPool::createGLObjects()
+{
+    glGenVertexArrays(1, &mVAO);
+
+    createStorage(mVBO, internal::_initialPoolVertices * vertexSize(), mVertexMapping);
+    mVertexAllocator.grow(internal::_initialPoolVertices);
+
+    createStorage(mEBO, internal::_initialPoolIndices * indexSize(), mIndexMapping);
+    mIndexAllocator.grow(internal::_initialPoolIndices);
+
+    setupVertexArray();
+}
+
+void vgl::GeometryPool::setupVertexArray()
+{
+    using internal::InstanceData;
+
+    glBindVertexArray(mVAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+    if (mFormat == GeometryFormat::Float || mFormat == GeometryFormat::Dynamic) {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, position)));
+        // TODO: adapt to lighting model
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, normal)));
+    } else {
+        // normalized, so the shaders read the same vec3 attributes as for float vertices
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex), reinterpret_cast<void*>(offsetof(QuantizedVertex, position)));
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(QuantizedVertex), reinterpret_cast<void*>(offsetof(QuantizedVertex, normal)));
+    }
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+
+    if (mInstanceVBO != 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+        for (GLuint row = 0; row < 3; ++row) {
+            glVertexAttribPointer(2 + row, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                reinterpret_cast<void*>(offsetof(InstanceData, modelRows) + row * sizeof(InstanceData::modelRows[0])));
+        }
+        glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), reinterpret_cast<void*>(offsetof(InstanceData, ambientColor)));
+        glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), reinterpret_cast<void*>(offsetof(InstanceData, diffuseColor)));
+        glVertexAttribPointer(7, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), reinterpret_cast<void*>(offsetof(InstanceData, specularColorShininess)));
+        for (GLuint location = 2; location <= 7; ++location) {
+            glVertexAttribDivisor(location, 1);
+            glEnableVertexAttribArray(location);
+        }
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void vgl::GeometryPool::createStorage(GLuint &buffer, std::size_t size, void *&mapping)
+{
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    if (dynamic()) {
+        // coherent, so writes are visible to the commands issued after them without flushing
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+        mapping = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+    } else {
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void vgl::GeometryPool::compactBuffer(GLuint &buffer, void *&mapping, BufferAllocator &allocator, std::size_t elementSize,
+                                      std::size_t Allocation::*offset, std::size_t Allocation::*count)
+{
+    std::vector<BufferAllocator::Move> moves = allocator.compact();
+    if (moves.empty()) {
+        return;
+    }
+
+    std::map<std::size_t, std::size_t> targets;
+    for (const BufferAllocator::Move& move : moves) {
+        targets.emplace(move.from, move.to);
+    }
+
+    // glCopyBufferSubData must not copy overlapping ranges within one buffer, so the live ranges go to a new one
+    GLuint compacted = 0;
+    void* compactedMapping = nullptr;
+    createStorage(compacted, allocator.capacity() * elementSize, compactedMapping);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, compacted);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+
+    // allocations the allocator did not move keep their offset but still have to be copied into the new buffer.
+    // dynamic allocations span all their copies
+    std::size_t copies = dynamic() ? FramesInFlight : 1;
+    for (Allocation& allocation : mAllocations) {
+        if (!allocation.used) {
+            continue;
+        }
+        std::size_t from = allocation.*offset;
+        auto target = targets.find(from);
+        std::size_t to = target != targets.end() ? target->second : from;
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from * elementSize, to * elementSize,
+                            allocation.*count * copies * elementSize);
+        allocation.*offset = to;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+    buffer = compacted;
+    mapping = compactedMapping;
+    if (dynamic()) {
+        // the copies have to land before the mapping is written
+        internal::finishCommands();
+    }
+
+    setupVertexArray();
+}
+
+void vgl::GeometryPool::resizeBuffer(GLuint &buffer, void *&mapping, std::size_t oldSize, std::size_t newSize)
+{
+    GLuint resized = 0;
+    void* resizedMapping = nullptr;
+    createStorage(resized, newSize, resizedMapping);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, resized);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glDeleteBuffers(1, &buffer);
+    buffer = resized;
+    mapping = resizedMapping;
+    if (dynamic()) {
+        internal::finishCommands();
+    }
+}
+
+void vgl::GeometryPool::release(Handle handle)
+{
+    Allocation& allocation = mAllocations[handle];
+    mVertexAllocator.free(allocation.vertexOffset);
+    mIndexAllocator.free(allocation.indexOffset);
+    allocation.used = false;
+    mFreeHandles.push_back(handle);
+}
+
+// ===============================================================================================================
+// GpuGeometry
+// ===============================================================================================================
+
+vgl::GpuGeometry::GpuGeometry(const MeshData &data)
+{
+    // vertexCount is the number of floats, 3 per vertex
+    std::size_t vertexCount = data.vertexCount / 3;
+    std::size_t indexCount = data.indexCount;
+    mVertexCount = vertexCount;
+    mIndexCount = indexCount;
+
+    // dynamic geometry is rewritten too often to be worth quantizing
+    bool dynamic = data.usage == GeometryUsage::Dynamic;
+    if (!data.quantize || dynamic) {
+        std::vector<Vertex> vertices(vertexCount);
+        for (std::size_t i = 0; i < vertexCount; ++i) {
+            vertices[i] = encodeVertex(data, i);
+        }
+        mFormat = dynamic ? GeometryFormat::Dynamic : GeometryFormat::Float;
+        mHandle = pool().allocate(vertices.data(), vertexCount, data.indices, indexCount);
+        mWriteFrame = pool().frame();
+        return;
+    }
+
+    std::array<GLfloat, 3> min;
+    std::array<GLfloat, 3> max;
+    min.fill(std::numeric_limits<GLfloat>::max());
+    max.fill(std::numeric_limits<GLfloat>::lowest());
+    for (std::size_t i = 0; i < vertexCount; ++i) {
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            min[axis] = std::min(min[axis], data.vertices[3 * i + axis]);
+            max[axis] = std::max(max[axis], data.vertices[3 * i + axis]);
+        }
+    }
+    GLfloat extent = std::max({max[0] - min[0], max[1] - min[1], max[2] - min[2]});
+    if (extent <= 0.0f) {
+        extent = 1.0f;
+    }
+    mPositionOffset = min;
+    mPositionScale = extent;
+
+    std::vector<QuantizedVertex> vertices(vertexCount);
+    for (std::size_t i = 0; i < vertexCount; ++i) {
+        vertices[i] = encodeQuantizedVertex(data, i);
+    }
+
+    // indices are relative to the base vertex, so 16 bits suffice whenever the mesh itself has few enough vertices
+    if (vertexCount <= std::size_t(std::numeric_limits<GLushort>::max()) + 1) {
+        std::vector<GLushort> indices(data.indices, data.indices + indexCount);
+        mFormat = GeometryFormat::Quantized16;
+        mHandle = pool().allocate(vertices.data(), vertexCount, indices.data(), indexCount);
+    } else {
+        mFormat = GeometryFormat::Quantized;
+        mHandle = pool().allocate(vertices.data(), vertexCount, data.indices, indexCount);
+    }
+}
+
+vgl::GpuGeometry::~GpuGeometry()
+{
+    pool().free(mHandle);
+}
+
+bool vgl::GpuGeometry::valid() const
+{
+    return mHandle != GeometryPool::InvalidHandle;
+}
+
+bool vgl::GpuGeometry::update(const MeshData &data)
+{
+    DirtyRanges vertices;
+    DirtyRanges indices;
+    vertices.add(0, mVertexCount);
+    indices.add(0, mIndexCount);
+    return update(data, vertices, indices);
+}
+
+bool vgl::GpuGeometry::update(const MeshData &data, DirtyRanges &vertices, DirtyRanges &indices)
+{
+    if (!valid() || static_cast<std::size_t>(data.vertexCount / 3) != mVertexCount
+        || static_cast<std::size_t>(data.indexCount) != mIndexCount) {
+        return false;
+    }
+
+    if (quantized()) {
+        for (const DirtyRanges::Range& range : vertices.coalesce()) {
+            for (std::size_t i = range.first; i < std::min(range.last, mVertexCount); ++i) {
+                for (std::size_t axis = 0; axis < 3; ++axis) {
+                    GLfloat normalized = (data.vertices[3 * i + axis] - mPositionOffset[axis]) / mPositionScale;
+                    if (normalized < 0.0f || normalized > 1.0f) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+
+    GeometryPool& pool = this->pool();
+    if (mFormat == GeometryFormat::Dynamic) {
+        // the copy written in this frame is not drawn yet and can be written again, otherwise the next one is taken
+        if (mWriteFrame != pool.frame()) {
+            pool.synchronize();
+            mCopy = (mCopy + 1) % GeometryPool::FramesInFlight;
+            mWriteFrame = pool.frame();
+        }
+        for (std::size_t copy = 0; copy < GeometryPool::FramesInFlight; ++copy) {
+            if (copy != mCopy) {
+                mStaleVertices[copy].add(vertices);
+                mStaleIndices[copy].add(indices);
+            }
+        }
+        vertices.add(mStaleVertices[mCopy]);
+        indices.add(mStaleIndices[mCopy]);
+        mStaleVertices[mCopy].clear();
+        mStaleIndices[mCopy].clear();
+    }
+
+    for (const DirtyRanges::Range& range : vertices.coalesce()) {
+        std::size_t last = std::min(range.last, mVertexCount);
+        if (range.first >= last) {
+            continue;
+        }
+        if (quantized()) {
+            std::vector<QuantizedVertex> encoded(last - range.first);
+            for (std::size_t i = range.first; i < last; ++i) {
+                encoded[i - range.first] = encodeQuantizedVertex(data, i);
+            }
+            if (!pool.writeVertices(mHandle, range.first, encoded.data(), encoded.size(), mCopy)) {
+                return false;
+            }
+        } else {
+            std::vector<Vertex> encoded(last - range.first);
+            for (std::size_t i = range.first; i < last; ++i) {
+                encoded[i - range.first] = encodeVertex(data, i);
+            }
+            if (!pool.writeVertices(mHandle, range.first, encoded.data(), encoded.size(), mCopy)) {
+                return false;
+            }
+        }
+    }
+
+    for (const DirtyRanges::Range& range : indices.coalesce()) {
+        std::size_t last = std::min(range.last, mIndexCount);
+        if (range.first >= last) {
+            continue;
+        }
+        if (mFormat == GeometryFormat::Quantized16) {
+            std::vector<GLushort> encoded(data.indices + range.first, data.indices + last);
+            if (!pool.writeIndices(mHandle, range.first, encoded.data(), encoded.size(), mCopy)) {
+                return false;
+            }
+        } else if (!pool.writeIndices(mHandle, range.first, data.indices + range.first, last - range.first, mCopy)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+vgl::GeometryFormat vgl::GpuGeometry::format() const
+{
+    return mFormat;
+}
+
+vgl::GeometryPool &vgl::GpuGeometry::pool() const
+{
+    return internal::geometryPool(mFormat);
+}
+
+bool vgl::GpuGeometry::replaced() const
+{
+    return mReplaced;
+}
+
+vgl::GeometryPool::Range vgl::GpuGeometry::range() const
+{
+    GeometryPool::Range range = pool().range(mHandle);
+    range.baseVertex += static_cast<GLint>(mCopy * mVertexCount);
+    range.firstIndex += static_cast<GLuint>(mCopy * mIndexCount);
+    return range;
+}
+
+bool vgl::GpuGeometry::quantized() const
+{
+    return mFormat == GeometryFormat::Quantized || mFormat == GeometryFormat::Quantized16;
+}
+
+const std::array<GLfloat, 3> &vgl::GpuGeometry::positionOffset() const
+{
+    return mPositionOffset;
+}
+
+GLfloat vgl::GpuGeometry::positionScale() const
+{
+    return mPositionScale;
+}
+
+vgl::Vertex vgl::GpuGeometry::encodeVertex(const MeshData &data, std::size_t i) const
+{
+    Vertex vertex;
+    std::copy(data.vertices + 3 * i, data.vertices + 3 * i + 3, vertex.position.begin());
+    std::copy(data.normals + 3 * i, data.normals + 3 * i + 3, vertex.normal.begin());
+    return vertex;
+}
+
+vgl::QuantizedVertex vgl::GpuGeometry::encodeQuantizedVertex(const MeshData &data, std::size_t i) const
+{
+    QuantizedVertex vertex;
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        GLfloat normalized = (data.vertices[3 * i + axis] - mPositionOffset[axis]) / mPositionScale;
+        vertex.position[axis] = static_cast<GLushort>(std::lround(std::clamp(normalized, 0.0f, 1.0f) * 65535.0f));
+    }
+    vertex.position[3] = 0;
+    vertex.normal = internal::packNormal(data.normals + 3 * i);
+    return vertex;
+}
+
+// ===============================================================================================================
+// GeometryCache
+// ===============================================================================================================
+
+vgl::SharedGpuGeometry vgl::GeometryCache::acquire(const MeshData &data)
+{
+    GeometryKey key(data);
+    auto it = mEntries.find(key);
+    if (it != mEntries.end()) {
+        if (SharedGpuGeometry geometry = it->second.lock()) {
+            return geometry;
+        }
+    }
+
+    // the deleter removes the entry, so the range is freed by whoever drops the last reference
+    SharedGpuGeometry geometry(new GpuGeometry(data), [this, key](GpuGeometry* geometry) {
+        auto it = mEntries.find(key);
+        if (it != mEntries.end() && it->second.expired()) {
+            mEntries.erase(it);
+        }
+        delete geometry;
+    });
+    mEntries[key] = geometry;
+    return geometry;
+}
+
+vgl::SharedGpuGeometry vgl::GeometryCache::replace(const MeshData &data, GpuGeometry &stale)
+{
+    stale.mReplaced = true;
+    // another mesh sharing the geometry may have replaced it already
+    auto it = mEntries.find(GeometryKey(data));
+    if (it != mEntries.end()) {
+        SharedGpuGeometry current = it->second.lock();
+        if (current != nullptr && current.get() != &stale) {
+            return current;
+        }
+        mEntries.erase(it);
+    }
+    return acquire(data);
+}
+
+std::size_t vgl::GeometryCache::size() const
+{
+    return mEntries.size();
+}
@@ -0,0 +1,340 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include <vgl/gl.h>
+
+
+namespace vgl {
+
+struct MeshData;
+
+// ===============================================================================================================
+// GeometryKey
+// ===============================================================================================================
+// identifies geometry by its source arrays, meshes with equal keys upload identical buffers
+struct GeometryKey {
+    const GLfloat* vertices = nullptr;
+    const GLfloat* normals = nullptr;
+    const GLuint* indices = nullptr;
+    GLsizei vertexCount = 0;
+    GLsizei indexCount = 0;
+    bool quantize = false;
+    bool dynamic = false;
+
+    GeometryKey() = default;
+    GeometryKey(const MeshData& data);
+
+    bool operator<(const GeometryKey& other) const;
+    bool operator==(const GeometryKey& other) const;
+};
+
+// ===============================================================================================================
+// BufferAllocator
+// ===============================================================================================================
+// best fit free list allocator over [0, capacity), offsets and sizes are in arbitrary units
+class BufferAllocator {
+public:
+    static constexpr std::size_t InvalidOffset = ~std::size_t(0);
+
+    struct Move {
+        std::size_t from;
+        std::size_t to;
+        std::size_t size;
+    };
+
+    BufferAllocator(std::size_t capacity = 0);
+
+    // InvalidOffset if there is no free block large enough
+    std::size_t allocate(std::size_t size);
+    void free(std::size_t offset);
+
+    void grow(std::size_t capacity);
+
+    // packs all allocations to the front, keeping their order
+    std::vector<Move> compact();
+
+    std::size_t capacity() const;
+    std::size_t used() const;
+    std::size_t largestFreeBlock() const;
+
+private:
+    void insertFreeBlock(std::size_t offset, std::size_t size);
+    void eraseFreeBlock(std::map<std::size_t, std::size_t>::iterator it);
+
+private:
+    std::size_t mCapacity = 0;
+    std::size_t mUsed = 0;
+
+    std::map<std::size_t, std::size_t> mAllocations{};       // offset -> size
+    std::map<std::size_t, std::size_t> mFreeByOffset{};      // offset -> size
+    std::multimap<std::size_t, std::size_t> mFreeBySize{};   // size -> offset
+};
+
+// ===============================================================================================================
+// DirtyRanges
+// ===============================================================================================================
+// element ranges waiting to be uploaded, overlapping and touching ranges are merged by coalesce()
+class DirtyRanges {
+public:
+    // [first, last)
+    struct Range {
+        std::size_t first;
+        std::size_t last;
+    };
+
+    void add(std::size_t first, std::size_t count);
+    void add(const DirtyRanges& other);
+    void clear();
+    bool empty() const;
+
+    // sorted and disjoint
+    const std::vector<Range>& coalesce();
+
+private:
+    std::vector<Range> mRanges{};
+    bool mCoalesced = true;
+};
+
+// ===============================================================================================================
+// GeometryPool
+// ===============================================================================================================
+// how often the geometry of a mesh changes
+enum class GeometryUsage {
+    // uploaded once, new data replaces the geometry
+    Static,
+    // rewritten in place whenever the mesh is set to the same data again, see GeometryFormat::Dynamic
+    Dynamic,
+};
+
+// vertex and index layout of a geometry pool
+enum class GeometryFormat {
+    // Vertex, 32 bit indices
+    Float,
+    // QuantizedVertex, 32 bit indices
+    Quantized,
+    // QuantizedVertex, 16 bit indices for meshes with at most 65536 vertices
+    Quantized16,
+    // Vertex, 32 bit indices, persistently mapped with one copy of each geometry per frame in flight
+    Dynamic,
+    Count
+};
+
+// interleaved vertex layouts of the pools
+struct Vertex {
+    std::array<GLfloat, 3> position;
+    std::array<GLfloat, 3> normal;
+};
+
+// unorm16 position relative to the bounds of the mesh (w is padding), signed normalized 2_10_10_10 normal
+struct QuantizedVertex {
+    std::array<GLushort, 4> position;
+    GLuint normal;
+};
+
+// suballocates the geometry of all meshes of one format from a shared vertex and index buffer drawn with a single vertex array
+class GeometryPool {
+public:
+    using Handle = std::uint32_t;
+    static constexpr Handle InvalidHandle = ~Handle(0);
+    // copies of each geometry in a dynamic pool
+    static constexpr std::size_t FramesInFlight = 3;
+
+    struct Range {
+        GLint baseVertex = 0;
+        GLuint firstIndex = 0;
+    };
+
+    GeometryPool(GeometryFormat format = GeometryFormat::Float);
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+    ~GeometryPool();
+
+    // rendering thread only, vertices and indices have to be in the format of the pool.
+    // dynamic pools allocate FramesInFlight copies and only reuse freed ranges once the GPU is done with them
+    Handle allocate(const void* vertices, std::size_t vertexCount, const void* indices, std::size_t indexCount);
+    void free(Handle handle);
+
+    // dynamic pools only, mapped memory of one copy of an allocation, valid until the next allocate() or compact()
+    void* vertexData(Handle handle, std::size_t copy) const;
+    void* indexData(Handle handle, std::size_t copy) const;
+    bool dynamic() const;
+
+    // overwrites count elements of an allocation starting at first, in the format of the pool.
+    // Static pools upload with glBufferSubData, dynamic pools write into the mapping of the given copy.
+    // Nothing is written and false returned if the range does not fit into one copy of the allocation
+    bool writeVertices(Handle handle, std::size_t first, const void* vertices, std::size_t count, std::size_t copy = 0);
+    bool writeIndices(Handle handle, std::size_t first, const void* indices, std::size_t count, std::size_t copy = 0);
+
+    // dynamic pools only, copies written in a frame are drawn by it and overwritten again FramesInFlight frames later.
+    // synchronize() waits until the GPU has finished the frame that last drew the copies written now, endFrame()
+    // fences the commands of the current frame
+    std::uint64_t frame() const;
+    void synchronize();
+    void endFrame();
+
+    // moves all allocations to the front of the buffers, ranges of existing handles change
+    void compact();
+
+    // offsets may change on allocate() and compact()
+    Range range(Handle handle) const;
+
+    GLuint vao() const;
+
+    GeometryFormat format() const;
+    // GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+    GLenum indexType() const;
+    // in bytes
+    std::size_t vertexSize() const;
+    std::size_t indexSize() const;
+
+    // per instance attributes (locations 2 - 7) are sourced from instanceVBO, see internal::InstanceData
+    void setInstanceBuffer(GLuint instanceVBO);
+
+    // in number of vertices and indices
+    std::size_t vertexCapacity() const;
+    std::size_t indexCapacity() const;
+    std::size_t usedVertices() const;
+    std::size_t usedIndices() const;
+
+private:
+    struct Allocation {
+        std::size_t vertexOffset = 0;
+        std::size_t vertexCount = 0;
+        std::size_t indexOffset = 0;
+        std::size_t indexCount = 0;
+        bool used = false;
+    };
+
+    std::size_t allocateVertices(std::size_t count);
+    std::size_t allocateIndices(std::size_t count);
+
+    void createGLObjects();
+    void setupVertexArray();
+    // immutable and persistently mapped for dynamic pools, mapping is only set for those
+    void createStorage(GLuint& buffer, std::size_t size, void*& mapping);
+    void compactBuffer(GLuint& buffer, void*& mapping, BufferAllocator& allocator, std::size_t elementSize,
+                       std::size_t Allocation::*offset, std::size_t Allocation::*count);
+    // copies the used part of a buffer into a new one of the given size
+    void resizeBuffer(GLuint& buffer, void*& mapping, std::size_t oldSize, std::size_t newSize);
+    void release(Handle handle);
+
+private:
+    GeometryFormat mFormat = GeometryFormat::Float;
+
+    BufferAllocator mVertexAllocator{};
+    BufferAllocator mIndexAllocator{};
+
+    std::vector<Allocation> mAllocations{};
+    std::vector<Handle> mFreeHandles{};
+
+    GLuint mVAO = 0, mVBO = 0, mEBO = 0;
+    GLuint mInstanceVBO = 0;
+
+    void* mVertexMapping = nullptr;
+    void* mIndexMapping = nullptr;
+    std::uint64_t mFrame = 0;
+    std::uint64_t mSynchronizedFrame = ~std::uint64_t(0);
+    std::array<GLsync, FramesInFlight> mFences{};
+    // freed handles and the frame they were freed in
+    std::vector<std::pair<Handle, std::uint64_t>> mRetiredHandles{};
+};
+
+namespace internal {
+    extern std::array<GeometryPool, static_cast<std::size_t>(GeometryFormat::Count)> _geometryPools;
+
+    GeometryPool& geometryPool(GeometryFormat format);
+} // namespace internal
+
+// ===============================================================================================================
+// GpuGeometry
+// ===============================================================================================================
+// range of one geometry in a geometry pool, freed together with the last reference
+class GpuGeometry {
+public:
+    // quantized if MeshData::quantize is set
+    GpuGeometry(const MeshData& data);
+    GpuGeometry(const GpuGeometry&) = delete;
+    GpuGeometry& operator=(const GpuGeometry&) = delete;
+    ~GpuGeometry();
+
+    // false if the allocation failed
+    bool valid() const;
+
+    // rewrites the geometry in place, false if the counts have changed or quantized positions
+    // left the box they were quantized in, then the geometry has to be created again
+    bool update(const MeshData& data);
+    // only uploads the given vertex and index ranges, the ranges are coalesced first
+    bool update(const MeshData& data, DirtyRanges& vertices, DirtyRanges& indices);
+
+    GeometryFormat format() const;
+    GeometryPool& pool() const;
+    GeometryPool::Range range() const;
+
+    // replaced in the geometry cache after a failed update, users have to acquire the new geometry
+    bool replaced() const;
+
+    // quantized positions decode to positionOffset + positionScale * position,
+    // the scale is the same on all axes so that it does not distort normals
+    bool quantized() const;
+    const std::array<GLfloat, 3>& positionOffset() const;
+    GLfloat positionScale() const;
+
+private:
+    friend class GeometryCache;
+
+    Vertex encodeVertex(const MeshData& data, std::size_t i) const;
+    QuantizedVertex encodeQuantizedVertex(const MeshData& data, std::size_t i) const;
+
+private:
+    GeometryFormat mFormat = GeometryFormat::Float;
+    GeometryPool::Handle mHandle = GeometryPool::InvalidHandle;
+
+    std::size_t mVertexCount = 0;
+    std::size_t mIndexCount = 0;
+
+    // dynamic geometry only, the copy drawn is the one written last. Ranges written into one copy are
+    // stale in the others until they are written next
+    std::size_t mCopy = 0;
+    std::uint64_t mWriteFrame = 0;
+    std::array<DirtyRanges, GeometryPool::FramesInFlight> mStaleVertices{};
+    std::array<DirtyRanges, GeometryPool::FramesInFlight> mStaleIndices{};
+
+    std::array<GLfloat, 3> mPositionOffset{0.0f, 0.0f, 0.0f};
+    GLfloat mPositionScale = 1.0f;
+
+    bool mReplaced = false;
+};
+
+using SharedGpuGeometry = std::shared_ptr<GpuGeometry>;
+
+// ===============================================================================================================
+// GeometryCache
+// ===============================================================================================================
+// hands out shared GPU geometry per GeometryKey, entries are removed when their last user releases them
+class GeometryCache {
+public:
+    GeometryCache() = default;
+    GeometryCache(const GeometryCache&) = delete;
+    GeometryCache& operator=(const GeometryCache&) = delete;
+
+    // rendering thread only
+    SharedGpuGeometry acquire(const MeshData& data);
+    // creates the geometry of data anew if the entry still holds stale, which could not be updated to data.
+    // stale is marked replaced, so every mesh sharing it acquires the new geometry
+    SharedGpuGeometry replace(const MeshData& data, GpuGeometry& stale);
+
+    std::size_t size() const;
+
+private:
+    std::map<GeometryKey, std::weak_ptr<GpuGeometry>> mEntries{};
+};
+
+namespace internal {
+    extern GeometryCache _geometryCache;
+} // namespace internal
+
+} // namespace vgl
@@ -3,6 +3,11 @@
 
 
 void (*glEnable)(GLenum) = nullptr;
+void (*glGetIntegerv)(GLenum, GLint*) = nullptr;
+void (*glColorMask)(GLboolean, GLboolean, GLboolean, GLboolean) = nullptr;
+void (*glDepthMask)(GLboolean) = nullptr;
+const GLubyte* (*glGetString)(GLenum) = nullptr;
+const GLubyte* (*glGetStringi)(GLenum, GLuint) = nullptr;
 
 void (*glViewport)(GLint, GLint, GLsizei, GLsizei) = nullptr;
 void (*glClearColor)(GLfloat, GLfloat, GLfloat, GLfloat) = nullptr;
@@ -14,6 +19,7 @@ void (*glCompileShader)(GLuint) = nullptr;
 void (*glGetShaderiv)(GLuint, GLenum, GLint*) = nullptr;
 void (*glGetShaderInfoLog)(GLuint, GLsizei, GLsizei*, GLchar*) = nullptr;
 void (*glDeleteShader)(GLuint) = nullptr;
+void (*glMaxShaderCompilerThreadsKHR)(GLuint) = nullptr;
 
 GLuint (*glCreateProgram)() = nullptr;
 void (*glAttachShader)(GLuint, GLuint) = nullptr;
@@ -22,6 +28,9 @@ void (*glGetProgramiv)(GLuint, GLenum, GLint*) = nullptr;
 void (*glGetProgramInfoLog)(GLuint, GLsizei, GLsizei*, GLchar*) = nullptr;
 void (*glUseProgram)(GLuint) = nullptr;
 void (*glDeleteProgram)(GLuint) = nullptr;
+void (*glProgramParameteri)(GLuint, GLenum, GLint) = nullptr;
+void (*glGetProgramBinary)(GLuint, GLsizei, GLsizei*, GLenum*, void*) = nullptr;
+void (*glProgramBinary)(GLuint, GLenum, const void*, GLsizei) = nullptr;
 
 GLint (*glGetUniformLocation)(GLuint, const GLchar*) = nullptr;
 void (*glUniform1f)(GLint, GLfloat) = nullptr;
@@ -35,20 +44,56 @@ void (*glDeleteVertexArrays)(GLsizei, const GLuint*) = nullptr;
 void (*glGenBuffers)(GLsizei, GLuint*) = nullptr;
 void (*glBindBuffer)(GLenum, GLuint) = nullptr;
 void (*glBufferData)(GLenum, GLsizeiptr, const void*, GLenum) = nullptr;
+void (*glBufferSubData)(GLenum, GLintptr, GLsizeiptr, const void*) = nullptr;
+void (*glBindBufferBase)(GLenum, GLuint, GLuint) = nullptr;
+void (*glBindBufferRange)(GLenum, GLuint, GLuint, GLintptr, GLsizeiptr) = nullptr;
+void (*glCopyBufferSubData)(GLenum, GLenum, GLintptr, GLintptr, GLsizeiptr) = nullptr;
+void (*glBufferStorage)(GLenum, GLsizeiptr, const void*, GLbitfield) = nullptr;
+void* (*glMapBufferRange)(GLenum, GLintptr, GLsizeiptr, GLbitfield) = nullptr;
 void (*glDeleteBuffers)(GLsizei, const GLuint*) = nullptr;
 
 void (*glEnableVertexAttribArray)(GLuint) = nullptr;
 void (*glVertexAttribPointer)(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) = nullptr;
+void (*glVertexAttribDivisor)(GLuint, GLuint) = nullptr;
 
 void (*glDrawElements)(GLenum, GLsizei, GLenum, const void*) = nullptr;
+void (*glDrawElementsBaseVertex)(GLenum, GLsizei, GLenum, const void*, GLint) = nullptr;
+void (*glDrawElementsInstancedBaseInstance)(GLenum, GLsizei, GLenum, const void*, GLsizei, GLuint) = nullptr;
+void (*glDrawElementsInstancedBaseVertexBaseInstance)(GLenum, GLsizei, GLenum, const void*, GLsizei, GLint, GLuint) = nullptr;
+void (*glMultiDrawElementsBaseVertex)(GLenum, const GLsizei*, GLenum, const void* const*, GLsizei, const GLint*) = nullptr;
+void (*glMultiDrawElementsIndirect)(GLenum, GLenum, const void*, GLsizei, GLsizei) = nullptr;
+
+GLsync (*glFenceSync)(GLenum, GLbitfield) = nullptr;
+GLenum (*glClientWaitSync)(GLsync, GLbitfield, GLuint64) = nullptr;
+void (*glDeleteSync)(GLsync) = nullptr;
+
+void (*glGenQueries)(GLsizei, GLuint*) = nullptr;
+void (*glDeleteQueries)(GLsizei, const GLuint*) = nullptr;
+void (*glBeginQuery)(GLenum, GLuint) = nullptr;
+void (*glEndQuery)(GLenum) = nullptr;
+void (*glGetQueryObjectuiv)(GLuint, GLenum, GLuint*) = nullptr;
+void (*glBeginConditionalRender)(GLuint, GLenum) = nullptr;
+void (*glEndConditionalRender)() = nullptr;
 
 void (*glDebugMessageCallback)(void (*)(GLenum, GLenum, GLuint, GLenum, GLsizei, const GLchar*, const void*), const void*) = nullptr;
 void (*glDebugMessageControl)(GLenum, GLenum, GLenum, GLsizei, const GLuint*, GLboolean) = nullptr;
 
 
+namespace vgl::internal {
+    // kept for the optional functions loaded after the extensions are known
+    void* (*_getProcAddress)(const char*) = nullptr;
+}
+
 void vgl::loadGLFunctions(void* (*getProcAddress)(const char*))
 {
+    internal::_getProcAddress = getProcAddress;
+
     glEnable = reinterpret_cast<decltype(glEnable)>(getProcAddress("glEnable"));
+    glGetIntegerv = reinterpret_cast<decltype(glGetIntegerv)>(getProcAddress("glGetIntegerv"));
+    glColorMask = reinterpret_cast<decltype(glColorMask)>(getProcAddress("glColorMask"));
+    glDepthMask = reinterpret_cast<decltype(glDepthMask)>(getProcAddress("glDepthMask"));
+    glGetString = reinterpret_cast<decltype(glGetString)>(getProcAddress("glGetString"));
+    glGetStringi = reinterpret_cast<decltype(glGetStringi)>(getProcAddress("glGetStringi"));
 
     glViewport = reinterpret_cast<decltype(glViewport)>(getProcAddress("glViewport"));
     glClearColor = reinterpret_cast<decltype(glClearColor)>(getProcAddress("glClearColor"));
@@ -68,6 +113,9 @@ void vgl::loadGLFunctions(void* (*getProcAddress)(const char*))
     glGetProgramInfoLog = reinterpret_cast<decltype(glGetProgramInfoLog)>(getProcAddress("glGetProgramInfoLog"));
     glUseProgram = reinterpret_cast<decltype(glUseProgram)>(getProcAddress("glUseProgram"));
     glDeleteProgram = reinterpret_cast<decltype(glDeleteProgram)>(getProcAddress("glDeleteProgram"));
+    glProgramParameteri = reinterpret_cast<decltype(glProgramParameteri)>(getProcAddress("glProgramParameteri"));
+    glGetProgramBinary = reinterpret_cast<decltype(glGetProgramBinary)>(getProcAddress("glGetProgramBinary"));
+    glProgramBinary = reinterpret_cast<decltype(glProgramBinary)>(getProcAddress("glProgramBinary"));
 
     glGetUniformLocation = reinterpret_cast<decltype(glGetUniformLocation)>(getProcAddress("glGetUniformLocation"));
     glUniform1f = reinterpret_cast<decltype(glUniform1f)>(getProcAddress("glUniform1f"));
@@ -81,13 +129,43 @@ void vgl::loadGLFunctions(void* (*getProcAddress)(const char*))
     glGenBuffers = reinterpret_cast<decltype(glGenBuffers)>(getProcAddress("glGenBuffers"));
     glBindBuffer = reinterpret_cast<decltype(glBindBuffer)>(getProcAddress("glBindBuffer"));
     glBufferData = reinterpret_cast<decltype(glBufferData)>(getProcAddress("glBufferData"));
+    glBufferSubData = reinterpret_cast<decltype(glBufferSubData)>(getProcAddress("glBufferSubData"));
+    glBindBufferBase = reinterpret_cast<decltype(glBindBufferBase)>(getProcAddress("glBindBufferBase"));
+    glBindBufferRange = reinterpret_cast<decltype(glBindBufferRange)>(getProcAddress("glBindBufferRange"));
+    glCopyBufferSubData = reinterpret_cast<decltype(glCopyBufferSubData)>(getProcAddress("glCopyBufferSubData"));
+    glBufferStorage = reinterpret_cast<decltype(glBufferStorage)>(getProcAddress("glBufferStorage"));
+    glMapBufferRange = reinterpret_cast<decltype(glMapBufferRange)>(getProcAddress("glMapBufferRange"));
     glDeleteBuffers = reinterpret_cast<decltype(glDeleteBuffers)>(getProcAddress("glDeleteBuffers"));
 
     glEnableVertexAttribArray = reinterpret_cast<decltype(glEnableVertexAttribArray)>(getProcAddress("glEnableVertexAttribArray"));
     glVertexAttribPointer = reinterpret_cast<decltype(glVertexAttribPointer)>(getProcAddress("glVertexAttribPointer"));
+    glVertexAttribDivisor = reinterpret_cast<decltype(glVertexAttribDivisor)>(getProcAddress("glVertexAttribDivisor"));
 
     glDrawElements = reinterpret_cast<decltype(glDrawElements)>(getProcAddress("glDrawElements"));
+    glDrawElementsBaseVertex = reinterpret_cast<decltype(glDrawElementsBaseVertex)>(getProcAddress("glDrawElementsBaseVertex"));
+    glDrawElementsInstancedBaseInstance = reinterpret_cast<decltype(glDrawElementsInstancedBaseInstance)>(getProcAddress("glDrawElementsInstancedBaseInstance"));
+    glDrawElementsInstancedBaseVertexBaseInstance = reinterpret_cast<decltype(glDrawElementsInstancedBaseVertexBaseInstance)>(getProcAddress("glDrawElementsInstancedBaseVertexBaseInstance"));
+    glMultiDrawElementsBaseVertex = reinterpret_cast<decltype(glMultiDrawElementsBaseVertex)>(getProcAddress("glMultiDrawElementsBaseVertex"));
+    glMultiDrawElementsIndirect = reinterpret_cast<decltype(glMultiDrawElementsIndirect)>(getProcAddress("glMultiDrawElementsIndirect"));
+
+    glFenceSync = reinterpret_cast<decltype(glFenceSync)>(getProcAddress("glFenceSync"));
+    glClientWaitSync = reinterpret_cast<decltype(glClientWaitSync)>(getProcAddress("glClientWaitSync"));
+    glDeleteSync = reinterpret_cast<decltype(glDeleteSync)>(getProcAddress("glDeleteSync"));
+
+    glGenQueries = reinterpret_cast<decltype(glGenQueries)>(getProcAddress("glGenQueries"));
+    glDeleteQueries = reinterpret_cast<decltype(glDeleteQueries)>(getProcAddress("glDeleteQueries"));
+    glBeginQuery = reinterpret_cast<decltype(glBeginQuery)>(getProcAddress("glBeginQuery"));
+    glEndQuery = reinterpret_cast<decltype(glEndQuery)>(getProcAddress("glEndQuery"));
+    glGetQueryObjectuiv = reinterpret_cast<decltype(glGetQueryObjectuiv)>(getProcAddress("glGetQueryObjectuiv"));
+    glBeginConditionalRender = reinterpret_cast<decltype(glBeginConditionalRender)>(getProcAddress("glBeginConditionalRender"));
+    glEndConditionalRender = reinterpret_cast<decltype(glEndConditionalRender)>(getProcAddress("glEndConditionalRender"));
 
     glDebugMessageCallback = reinterpret_cast<decltype(glDebugMessageCallback)>(getProcAddress("glDebugMessageCallback"));
     glDebugMessageControl = reinterpret_cast<decltype(glDebugMessageControl)>(getProcAddress("glDebugMessageControl"));
-}
\ No newline at end of file
+}
+
+void vgl::loadParallelShaderCompileFunctions(bool khr)
+{
+    const char* name = khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB";
+    glMaxShaderCompilerThreadsKHR = reinterpret_cast<decltype(glMaxShaderCompilerThreadsKHR)>(internal::_getProcAddress(name));
+}
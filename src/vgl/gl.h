@@ -13,10 +13,15 @@ using GLboolean = bool;
 using GLchar = char;
 using GLint = std::int32_t;
 using GLuint = std::uint32_t;
+using GLubyte = std::uint8_t;
+using GLushort = std::uint16_t;
 using GLsizei = std::uint32_t;
 using GLsizeiptr = std::uintptr_t;
+using GLintptr = std::intptr_t;
 using GLenum = std::uint32_t;
 using GLbitfield = std::uint32_t;
+using GLuint64 = std::uint64_t;
+using GLsync = struct __GLsync*;
 
 #if __cplusplus >= 202302L
 using GLfloat = std::float32_t;
@@ -27,8 +32,10 @@ using GLfloat = float;
 // ------------------------------------------------------------------------------
 // OpenGL constants
 // ------------------------------------------------------------------------------
+#define GL_UNSIGNED_SHORT 0x1403
 #define GL_UNSIGNED_INT 0x1405
 #define GL_FLOAT 0x1406
+#define GL_INT_2_10_10_10_REV 0x8D9F
 
 #define GL_FALSE 0
 #define GL_TRUE 1
@@ -40,6 +47,17 @@ using GLfloat = float;
 
 #define GL_DEPTH_TEST 0x0B71
 
+#define GL_VENDOR 0x1F00
+#define GL_RENDERER 0x1F01
+#define GL_VERSION 0x1F02
+#define GL_EXTENSIONS 0x1F03
+#define GL_NUM_EXTENSIONS 0x821D
+
+#define GL_ANY_SAMPLES_PASSED_CONSERVATIVE 0x8D6A
+#define GL_QUERY_RESULT 0x8866
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#define GL_QUERY_BY_REGION_NO_WAIT 0x8E16
+
 #define GL_VERTEX_SHADER 0x8B31
 // #define GL_TESS_CONTROL_SHADER 0x8E88
 // #define GL_TESS_EVALUATION_SHADER 0x8E87
@@ -56,10 +74,34 @@ using GLfloat = float;
 
 #define GL_LINK_STATUS 0x8B82
 
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+
 #define GL_ARRAY_BUFFER 0x8892
 #define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#define GL_UNIFORM_BUFFER 0x8A11
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#define GL_COPY_READ_BUFFER 0x8F36
+#define GL_COPY_WRITE_BUFFER 0x8F37
+
+#define GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT 0x90DF
+
+#define GL_MAP_WRITE_BIT 0x0002
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#define GL_TIMEOUT_EXPIRED 0x911B
+#define GL_WAIT_FAILED 0x911D
 
+#define GL_STREAM_DRAW 0x88E0
 #define GL_STATIC_DRAW 0x88E4
+#define GL_DYNAMIC_DRAW 0x88E8
 
 #define GL_TRIANGLES 0x0004
 
@@ -81,6 +123,11 @@ using GLfloat = float;
 // OpenGL functions
 // ------------------------------------------------------------------------------
 extern void (*glEnable)(GLenum);
+extern void (*glGetIntegerv)(GLenum, GLint*);
+extern void (*glColorMask)(GLboolean, GLboolean, GLboolean, GLboolean);
+extern void (*glDepthMask)(GLboolean);
+extern const GLubyte* (*glGetString)(GLenum);
+extern const GLubyte* (*glGetStringi)(GLenum, GLuint);
 
 extern void (*glViewport)(GLint, GLint, GLsizei, GLsizei);
 extern void (*glClearColor)(GLfloat, GLfloat, GLfloat, GLfloat);
@@ -92,6 +139,8 @@ extern void (*glCompileShader)(GLuint);
 extern void (*glGetShaderiv)(GLuint, GLenum, GLint*);
 extern void (*glGetShaderInfoLog)(GLuint, GLsizei, GLsizei*, GLchar*);
 extern void (*glDeleteShader)(GLuint);
+// optional, nullptr unless loaded by loadParallelShaderCompileFunctions()
+extern void (*glMaxShaderCompilerThreadsKHR)(GLuint);
 
 extern GLuint (*glCreateProgram)();
 extern void (*glAttachShader)(GLuint, GLuint);
@@ -100,6 +149,9 @@ extern void (*glGetProgramiv)(GLuint, GLenum, GLint*);
 extern void (*glGetProgramInfoLog)(GLuint, GLsizei, GLsizei*, GLchar*);
 extern void (*glUseProgram)(GLuint);
 extern void (*glDeleteProgram)(GLuint);
+extern void (*glProgramParameteri)(GLuint, GLenum, GLint);
+extern void (*glGetProgramBinary)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+extern void (*glProgramBinary)(GLuint, GLenum, const void*, GLsizei);
 
 extern GLint (*glGetUniformLocation)(GLuint, const GLchar*);
 extern void (*glUniform1f)(GLint, GLfloat);
@@ -113,12 +165,36 @@ extern void (*glDeleteVertexArrays)(GLsizei, const GLuint*);
 extern void (*glGenBuffers)(GLsizei, GLuint*);
 extern void (*glBindBuffer)(GLenum, GLuint);
 extern void (*glBufferData)(GLenum, GLsizeiptr, const void*, GLenum);
+extern void (*glBufferSubData)(GLenum, GLintptr, GLsizeiptr, const void*);
+extern void (*glBindBufferBase)(GLenum, GLuint, GLuint);
+extern void (*glBindBufferRange)(GLenum, GLuint, GLuint, GLintptr, GLsizeiptr);
+extern void (*glCopyBufferSubData)(GLenum, GLenum, GLintptr, GLintptr, GLsizeiptr);
+extern void (*glBufferStorage)(GLenum, GLsizeiptr, const void*, GLbitfield);
+extern void* (*glMapBufferRange)(GLenum, GLintptr, GLsizeiptr, GLbitfield);
 extern void (*glDeleteBuffers)(GLsizei, const GLuint*);
 
 extern void (*glEnableVertexAttribArray)(GLuint);
 extern void (*glVertexAttribPointer)(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*);
+extern void (*glVertexAttribDivisor)(GLuint, GLuint);
 
 extern void (*glDrawElements)(GLenum, GLsizei, GLenum, const void*);
+extern void (*glDrawElementsBaseVertex)(GLenum, GLsizei, GLenum, const void*, GLint);
+extern void (*glDrawElementsInstancedBaseInstance)(GLenum, GLsizei, GLenum, const void*, GLsizei, GLuint);
+extern void (*glDrawElementsInstancedBaseVertexBaseInstance)(GLenum, GLsizei, GLenum, const void*, GLsizei, GLint, GLuint);
+extern void (*glMultiDrawElementsBaseVertex)(GLenum, const GLsizei*, GLenum, const void* const*, GLsizei, const GLint*);
+extern void (*glMultiDrawElementsIndirect)(GLenum, GLenum, const void*, GLsizei, GLsizei);
+
+extern GLsync (*glFenceSync)(GLenum, GLbitfield);
+extern GLenum (*glClientWaitSync)(GLsync, GLbitfield, GLuint64);
+extern void (*glDeleteSync)(GLsync);
+
+extern void (*glGenQueries)(GLsizei, GLuint*);
+extern void (*glDeleteQueries)(GLsizei, const GLuint*);
+extern void (*glBeginQuery)(GLenum, GLuint);
+extern void (*glEndQuery)(GLenum);
+extern void (*glGetQueryObjectuiv)(GLuint, GLenum, GLuint*);
+extern void (*glBeginConditionalRender)(GLuint, GLenum);
+extern void (*glEndConditionalRender)();
 
 extern void (*glDebugMessageCallback)(void (*)(GLenum, GLenum, GLuint, GLenum, GLsizei, const GLchar*, const void*), const void*);
 extern void (*glDebugMessageControl)(GLenum, GLenum, GLenum, GLsizei, const GLuint*, GLboolean);
@@ -128,5 +204,8 @@ extern void (*glDebugMessageControl)(GLenum, GLenum, GLenum, GLsizei, const GLui
 namespace vgl {
 
 void loadGLFunctions(void* (*getProcAddress)(const char*));
+// entry points of KHR_parallel_shader_compile or its ARB variant, only call once the extension was found
+// since getProcAddress aborts on missing functions
+void loadParallelShaderCompileFunctions(bool khr);
 
 } // namespace vgl
@@ -0,0 +1,174 @@
+#include <vgl/jobs.h>
+
+
+namespace vgl::internal {
+    struct JobNode {
+        std::function<void()> job;
+        // dependencies still running, plus one held by run() until all of them are registered
+        std::atomic<std::size_t> pendingCount = 1;
+        std::atomic<bool> finished = false;
+
+        // jobs depending on this one, queued when it finishes
+        std::mutex mutex;
+        std::vector<JobHandle> continuations;
+        bool done = false;
+    };
+
+    thread_local const JobSystem* _workerSystem = nullptr;
+    thread_local std::size_t _workerQueue = 0;
+}
+
+// ===============================================================================================================
+// JobSystem
+// ===============================================================================================================
+
+vgl::JobSystem::JobSystem(std::size_t workerCount)
+{
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    }
+    for (std::size_t i = 0; i <= workerCount; ++i) {
+        mQueues.push_back(std::make_unique<Queue>());
+    }
+    for (std::size_t i = 1; i <= workerCount; ++i) {
+        mWorkers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+vgl::JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mStop = true;
+    }
+    mWake.notify_all();
+    for (std::thread& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+std::size_t vgl::JobSystem::workerCount() const
+{
+    return mWorkers.size();
+}
+
+vgl::JobHandle vgl::JobSystem::run(std::function<void()> job, const std::vector<JobHandle> &dependencies)
+{
+    JobHandle node = std::make_shared<internal::JobNode>();
+    node->job = std::move(job);
+    node->pendingCount.fetch_add(dependencies.size(), std::memory_order_relaxed);
+    for (const JobHandle& dependency : dependencies) {
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (dependency->done) {
+            node->pendingCount.fetch_sub(1, std::memory_order_relaxed);
+        } else {
+            dependency->continuations.push_back(node);
+        }
+    }
+    if (node->pendingCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        schedule(node);
+    }
+    return node;
+}
+
+bool vgl::JobSystem::finished(const JobHandle &job) const
+{
+    return job->finished.load(std::memory_order_acquire);
+}
+
+void vgl::JobSystem::wait(const JobHandle &job)
+{
+    while (!finished(job)) {
+        if (JobHandle other = take()) {
+            execute(other);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void vgl::JobSystem::schedule(JobHandle job)
+{
+    Queue& queue = *mQueues[queueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+    mQueuedCount.fetch_add(1, std::memory_order_release);
+    {
+        // a worker between its last look at the count and going to sleep would miss the notification
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+    }
+    mWake.notify_one();
+}
+
+vgl::JobHandle vgl::JobSystem::take()
+{
+    std::size_t own = queueIndex();
+    for (std::size_t i = 0; i < mQueues.size(); ++i) {
+        Queue& queue = *mQueues[(own + i) % mQueues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) {
+            continue;
+        }
+        // the newest own job is likely still in cache, stolen ones are the oldest and usually the largest
+        JobHandle job;
+        if (i == 0) {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        } else {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+        mQueuedCount.fetch_sub(1, std::memory_order_relaxed);
+        return job;
+    }
+    return nullptr;
+}
+
+void vgl::JobSystem::execute(const JobHandle &job)
+{
+    job->job();
+    job->job = nullptr;
+
+    std::vector<JobHandle> continuations;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->done = true;
+        std::swap(continuations, job->continuations);
+    }
+    job->finished.store(true, std::memory_order_release);
+    for (JobHandle& continuation : continuations) {
+        if (continuation->pendingCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            schedule(std::move(continuation));
+        }
+    }
+}
+
+void vgl::JobSystem::workerLoop(std::size_t queue)
+{
+    internal::_workerSystem = this;
+    internal::_workerQueue = queue;
+    for (;;) {
+        if (JobHandle job = take()) {
+            execute(job);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mSleepMutex);
+        mWake.wait(lock, [this]() { return mStop || mQueuedCount.load(std::memory_order_acquire) > 0; });
+        if (mStop) {
+            return;
+        }
+    }
+}
+
+std::size_t vgl::JobSystem::queueIndex() const
+{
+    return internal::_workerSystem == this ? internal::_workerQueue : 0;
+}
+
+vgl::JobSystem &vgl::jobSystem()
+{
+    static JobSystem system;
+    return system;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace vgl {
+
+namespace internal {
+    struct JobNode;
+}
+
+using JobHandle = std::shared_ptr<internal::JobNode>;
+
+// ===============================================================================================================
+// JobSystem
+// ===============================================================================================================
+// work stealing thread pool. Every worker takes the newest job of its own deque and steals the oldest ones of
+// the others when it runs dry, threads outside the pool share one more deque. Waiting threads run jobs
+// themselves instead of blocking, so jobs may start and wait for other jobs
+class JobSystem {
+public:
+    // 0 starts one worker less than there are hardware threads, the waiting thread makes up for it
+    explicit JobSystem(std::size_t workerCount = 0);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    std::size_t workerCount() const;
+
+    // any thread, the job is queued once all dependencies have finished
+    JobHandle run(std::function<void()> job, const std::vector<JobHandle>& dependencies = {});
+    bool finished(const JobHandle& job) const;
+    // runs queued jobs until job has finished
+    void wait(const JobHandle& job);
+
+    // calls body(begin, end) for ranges covering [0, count) of at least grainSize elements, the calling thread
+    // takes the first range. Returns once all ranges are done
+    template <typename Body>
+    void parallelFor(std::size_t count, std::size_t grainSize, Body&& body);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<JobHandle> jobs;
+    };
+
+    void schedule(JobHandle job);
+    // own queue first, then the others
+    JobHandle take();
+    void execute(const JobHandle& job);
+    void workerLoop(std::size_t queue);
+    // queue of the calling thread, 0 for threads outside the pool
+    std::size_t queueIndex() const;
+
+private:
+    std::vector<std::unique_ptr<Queue>> mQueues{};
+    std::vector<std::thread> mWorkers{};
+
+    // workers sleep while nothing is queued
+    std::atomic<std::size_t> mQueuedCount = 0;
+    std::mutex mSleepMutex{};
+    std::condition_variable mWake{};
+    bool mStop = false;
+};
+
+// shared by everything in vgl, started on first use
+JobSystem& jobSystem();
+
+template <typename Body>
+void JobSystem::parallelFor(std::size_t count, std::size_t grainSize, Body&& body)
+{
+    // a few ranges per thread leave room for stealing when ranges take different times
+    std::size_t maxRanges = (workerCount() + 1) * 4;
+    std::size_t rangeCount = std::min((count + std::max<std::size_t>(grainSize, 1) - 1) / std::max<std::size_t>(grainSize, 1), maxRanges);
+    if (rangeCount <= 1) {
+        if (count > 0) {
+            body(std::size_t(0), count);
+        }
+        return;
+    }
+    std::size_t rangeSize = (count + rangeCount - 1) / rangeCount;
+
+    std::vector<JobHandle> jobs;
+    for (std::size_t begin = rangeSize; begin < count; begin += rangeSize) {
+        std::size_t end = std::min(begin + rangeSize, count);
+        jobs.push_back(run([&body, begin, end]() { body(begin, end); }));
+    }
+    body(std::size_t(0), rangeSize);
+    for (const JobHandle& job : jobs) {
+        wait(job);
+    }
+}
+
+} // namespace vgl
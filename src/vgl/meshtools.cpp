@@ -0,0 +1,964 @@
+#include <vgl/meshtools.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <queue>
+#include <unordered_map>
+
+
+namespace vgl::internal {
+    // weight of the planes that keep mesh and material borders in place
+    constexpr double _borderQuadricWeight = 10.0;
+    // collapses may not turn an adjacent triangle by more than about 80 degrees
+    constexpr double _minNormalDot = 0.2;
+
+    struct Quadric {
+        // upper triangle of the symmetric 4x4 matrix
+        std::array<double, 10> m{};
+
+        static Quadric fromPlane(double a, double b, double c, double d, double weight)
+        {
+            Quadric q;
+            q.m = {a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d};
+            for (double& value : q.m) {
+                value *= weight;
+            }
+            return q;
+        }
+
+        Quadric& operator+=(const Quadric& other)
+        {
+            for (std::size_t i = 0; i < m.size(); ++i) {
+                m[i] += other.m[i];
+            }
+            return *this;
+        }
+
+        // sum of the squared distances of p to the planes
+        double error(const std::array<double, 3>& p) const
+        {
+            double x = p[0], y = p[1], z = p[2];
+            return m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x
+                + m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y
+                + m[7] * z * z + 2 * m[8] * z
+                + m[9];
+        }
+    };
+
+    using dvec3 = std::array<double, 3>;
+
+    dvec3 sub(const dvec3& a, const dvec3& b)
+    {
+        return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+    }
+
+    dvec3 cross(const dvec3& a, const dvec3& b)
+    {
+        return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+    }
+
+    double dot(const dvec3& a, const dvec3& b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    // unnormalized normals keep their length for the area, zero for degenerate triangles
+    dvec3 normalized(const dvec3& v)
+    {
+        double length = std::sqrt(dot(v, v));
+        return length > 0.0 ? dvec3{v[0] / length, v[1] / length, v[2] / length} : dvec3{0.0, 0.0, 0.0};
+    }
+
+    struct Collapse {
+        double cost;
+        std::uint32_t from;
+        std::uint32_t to;
+        std::uint32_t fromVersion;
+        std::uint32_t toVersion;
+
+        bool operator>(const Collapse& other) const
+        {
+            return cost > other.cost;
+        }
+    };
+
+    class Simplifier {
+    public:
+        Simplifier(const MeshData& data)
+            : mData(data)
+        {
+            std::size_t vertexCount = data.vertexCount / 3;
+            std::size_t triangleCount = data.indexCount / 3;
+
+            // vertices at the same position are one vertex for the topology, so seams with split normals stay closed
+            std::map<std::array<GLfloat, 3>, std::uint32_t> positionIds;
+            mVertexPosition.resize(vertexCount);
+            for (std::size_t v = 0; v < vertexCount; ++v) {
+                std::array<GLfloat, 3> position = {data.vertices[3 * v], data.vertices[3 * v + 1], data.vertices[3 * v + 2]};
+                auto [it, inserted] = positionIds.emplace(position, static_cast<std::uint32_t>(mPositions.size()));
+                if (inserted) {
+                    mPositions.push_back({position[0], position[1], position[2]});
+                    mPositionVertices.emplace_back();
+                }
+                mVertexPosition[v] = it->second;
+                mPositionVertices[it->second].push_back(static_cast<std::uint32_t>(v));
+            }
+
+            std::size_t positionCount = mPositions.size();
+            mQuadrics.resize(positionCount);
+            mPositionTriangles.resize(positionCount);
+            mVersions.assign(positionCount, 0);
+            mPositionAlive.assign(positionCount, true);
+
+            mTriangles.resize(triangleCount);
+            mTriangleMaterial.resize(triangleCount);
+            mTriangleAlive.assign(triangleCount, true);
+            mAliveTriangles = triangleCount;
+
+            std::size_t material = 0;
+            std::size_t materialEnd = data.matTriangleCount.empty() ? triangleCount : data.matTriangleCount[0];
+            for (std::size_t t = 0; t < triangleCount; ++t) {
+                while (material + 1 < data.matTriangleCount.size() && t >= materialEnd) {
+                    ++material;
+                    materialEnd += data.matTriangleCount[material];
+                }
+                mTriangleMaterial[t] = static_cast<std::uint32_t>(material);
+                for (std::size_t corner = 0; corner < 3; ++corner) {
+                    mTriangles[t][corner] = data.indices[3 * t + corner];
+                    mPositionTriangles[position(t, corner)].push_back(static_cast<std::uint32_t>(t));
+                }
+            }
+
+            addPlaneQuadrics();
+            addBorderQuadrics();
+        }
+
+        // returns the largest collapse error
+        double run(std::size_t targetTriangles)
+        {
+            for (std::uint32_t p = 0; p < mPositions.size(); ++p) {
+                pushCollapses(p);
+            }
+
+            double maxError = 0.0;
+            while (mAliveTriangles > targetTriangles && !mHeap.empty()) {
+                Collapse collapse = mHeap.top();
+                mHeap.pop();
+                if (mVersions[collapse.from] != collapse.fromVersion || mVersions[collapse.to] != collapse.toVersion
+                    || !mPositionAlive[collapse.from] || !mPositionAlive[collapse.to]) {
+                    continue;
+                }
+                if (!valid(collapse.from, collapse.to)) {
+                    continue;
+                }
+                apply(collapse.from, collapse.to);
+                maxError = std::max(maxError, collapse.cost);
+            }
+            return maxError;
+        }
+
+        SharedOwnedMeshData result() const
+        {
+            SharedOwnedMeshData result = std::make_shared<OwnedMeshData>();
+            result->materials = mData.materials;
+            result->matTriangleCount.assign(mData.matTriangleCount.size(), 0);
+            result->quantize = mData.quantize;
+            result->usage = mData.usage;
+
+            // compacts the vertices that are still referenced, triangles keep their order
+            std::vector<GLuint> remap(mVertexPosition.size(), ~GLuint(0));
+            for (std::size_t t = 0; t < mTriangles.size(); ++t) {
+                if (!mTriangleAlive[t]) {
+                    continue;
+                }
+                for (GLuint v : mTriangles[t]) {
+                    if (remap[v] == ~GLuint(0)) {
+                        remap[v] = static_cast<GLuint>(result->vertexStorage.size() / 3);
+                        result->vertexStorage.insert(result->vertexStorage.end(), mData.vertices + 3 * v, mData.vertices + 3 * v + 3);
+                        result->normalStorage.insert(result->normalStorage.end(), mData.normals + 3 * v, mData.normals + 3 * v + 3);
+                    }
+                    result->indexStorage.push_back(remap[v]);
+                }
+                if (!result->matTriangleCount.empty()) {
+                    ++result->matTriangleCount[mTriangleMaterial[t]];
+                }
+            }
+            result->bindStorage();
+            return result;
+        }
+
+    private:
+        std::uint32_t position(std::size_t triangle, std::size_t corner) const
+        {
+            return mVertexPosition[mTriangles[triangle][corner]];
+        }
+
+        dvec3 triangleNormal(std::size_t triangle, std::uint32_t replaced = ~0u, std::uint32_t replacement = ~0u) const
+        {
+            std::array<dvec3, 3> p;
+            for (std::size_t corner = 0; corner < 3; ++corner) {
+                std::uint32_t id = position(triangle, corner);
+                p[corner] = mPositions[id == replaced ? replacement : id];
+            }
+            return cross(sub(p[1], p[0]), sub(p[2], p[0]));
+        }
+
+        void addPlaneQuadrics()
+        {
+            for (std::size_t t = 0; t < mTriangles.size(); ++t) {
+                dvec3 n = normalized(triangleNormal(t));
+                double d = -dot(n, mPositions[position(t, 0)]);
+                Quadric q = Quadric::fromPlane(n[0], n[1], n[2], d, 1.0);
+                for (std::size_t corner = 0; corner < 3; ++corner) {
+                    mQuadrics[position(t, corner)] += q;
+                }
+            }
+        }
+
+        void addBorderQuadrics()
+        {
+            // edges with a single triangle, or with triangles of different materials
+            std::map<std::pair<std::uint32_t, std::uint32_t>, std::vector<std::uint32_t>> edges;
+            for (std::size_t t = 0; t < mTriangles.size(); ++t) {
+                for (std::size_t corner = 0; corner < 3; ++corner) {
+                    std::uint32_t a = position(t, corner);
+                    std::uint32_t b = position(t, (corner + 1) % 3);
+                    edges[{std::min(a, b), std::max(a, b)}].push_back(static_cast<std::uint32_t>(t));
+                }
+            }
+
+            for (const auto& [edge, triangles] : edges) {
+                bool border = triangles.size() == 1;
+                for (std::uint32_t t : triangles) {
+                    border = border || mTriangleMaterial[t] != mTriangleMaterial[triangles.front()];
+                }
+                if (!border) {
+                    continue;
+                }
+
+                // plane through the edge, perpendicular to the triangle
+                dvec3 direction = sub(mPositions[edge.second], mPositions[edge.first]);
+                for (std::uint32_t t : triangles) {
+                    dvec3 n = normalized(cross(direction, normalized(triangleNormal(t))));
+                    double d = -dot(n, mPositions[edge.first]);
+                    Quadric q = Quadric::fromPlane(n[0], n[1], n[2], d, _borderQuadricWeight);
+                    mQuadrics[edge.first] += q;
+                    mQuadrics[edge.second] += q;
+                }
+            }
+        }
+
+        void pushCollapses(std::uint32_t p)
+        {
+            std::vector<std::uint32_t> neighbours;
+            for (std::uint32_t t : mPositionTriangles[p]) {
+                if (!mTriangleAlive[t]) {
+                    continue;
+                }
+                for (std::size_t corner = 0; corner < 3; ++corner) {
+                    std::uint32_t q = position(t, corner);
+                    if (q != p) {
+                        neighbours.push_back(q);
+                    }
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+            for (std::uint32_t q : neighbours) {
+                Quadric sum = mQuadrics[p];
+                sum += mQuadrics[q];
+                // half edge collapses only, onto whichever end point is cheaper
+                double toQ = sum.error(mPositions[q]);
+                double toP = sum.error(mPositions[p]);
+                if (toQ <= toP) {
+                    mHeap.push(Collapse{std::max(toQ, 0.0), p, q, mVersions[p], mVersions[q]});
+                } else {
+                    mHeap.push(Collapse{std::max(toP, 0.0), q, p, mVersions[q], mVersions[p]});
+                }
+            }
+        }
+
+        bool valid(std::uint32_t from, std::uint32_t to) const
+        {
+            for (std::uint32_t t : mPositionTriangles[from]) {
+                if (!mTriangleAlive[t]) {
+                    continue;
+                }
+                bool collapses = false;
+                for (std::size_t corner = 0; corner < 3; ++corner) {
+                    collapses = collapses || position(t, corner) == to;
+                }
+                if (collapses) {
+                    continue;
+                }
+
+                dvec3 before = normalized(triangleNormal(t));
+                dvec3 after = normalized(triangleNormal(t, from, to));
+                if (dot(before, after) < _minNormalDot) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void apply(std::uint32_t from, std::uint32_t to)
+        {
+            // every vertex at from continues as the vertex at to with the most similar normal
+            std::unordered_map<GLuint, GLuint> vertexRemap;
+            for (std::uint32_t v : mPositionVertices[from]) {
+                GLuint best = mPositionVertices[to].front();
+                double bestDot = -2.0;
+                for (std::uint32_t w : mPositionVertices[to]) {
+                    double d = 0.0;
+                    for (std::size_t axis = 0; axis < 3; ++axis) {
+                        d += static_cast<double>(mData.normals[3 * v + axis]) * mData.normals[3 * w + axis];
+                    }
+                    if (d > bestDot) {
+                        bestDot = d;
+                        best = w;
+                    }
+                }
+                vertexRemap[v] = best;
+            }
+
+            for (std::uint32_t t : mPositionTriangles[from]) {
+                if (!mTriangleAlive[t]) {
+                    continue;
+                }
+                for (GLuint& v : mTriangles[t]) {
+                    auto it = vertexRemap.find(v);
+                    if (it != vertexRemap.end()) {
+                        v = it->second;
+                    }
+                }
+                if (position(t, 0) == position(t, 1) || position(t, 1) == position(t, 2) || position(t, 2) == position(t, 0)) {
+                    mTriangleAlive[t] = false;
+                    --mAliveTriangles;
+                } else {
+                    mPositionTriangles[to].push_back(t);
+                }
+            }
+
+            mQuadrics[to] += mQuadrics[from];
+            mPositionAlive[from] = false;
+            mPositionTriangles[from].clear();
+            ++mVersions[from];
+            ++mVersions[to];
+
+            // drop dead triangles so the lists do not grow with every collapse
+            auto& triangles = mPositionTriangles[to];
+            triangles.erase(std::remove_if(triangles.begin(), triangles.end(), [this](std::uint32_t t) { return !mTriangleAlive[t]; }), triangles.end());
+            std::sort(triangles.begin(), triangles.end());
+            triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+            // the costs of all edges around the merged vertex have changed
+            std::vector<std::uint32_t> neighbours;
+            for (std::uint32_t t : triangles) {
+                for (std::size_t corner = 0; corner < 3; ++corner) {
+                    if (position(t, corner) != to) {
+                        neighbours.push_back(position(t, corner));
+                    }
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+            for (std::uint32_t neighbour : neighbours) {
+                ++mVersions[neighbour];
+            }
+            pushCollapses(to);
+            for (std::uint32_t neighbour : neighbours) {
+                pushCollapses(neighbour);
+            }
+        }
+
+    private:
+        const MeshData& mData;
+
+        std::vector<dvec3> mPositions;
+        std::vector<std::uint32_t> mVertexPosition;
+        std::vector<std::vector<std::uint32_t>> mPositionVertices;
+        std::vector<std::vector<std::uint32_t>> mPositionTriangles;
+        std::vector<Quadric> mQuadrics;
+        std::vector<std::uint32_t> mVersions;
+        std::vector<bool> mPositionAlive;
+
+        std::vector<std::array<GLuint, 3>> mTriangles;
+        std::vector<std::uint32_t> mTriangleMaterial;
+        std::vector<bool> mTriangleAlive;
+        std::size_t mAliveTriangles = 0;
+
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> mHeap;
+    };
+} // namespace vgl::internal
+
+// ===============================================================================================================
+// OwnedMeshData
+// ===============================================================================================================
+
+void vgl::OwnedMeshData::bindStorage()
+{
+    vertices = vertexStorage.data();
+    normals = normalStorage.data();
+    vertexCount = static_cast<GLsizei>(vertexStorage.size());
+    indices = indexStorage.data();
+    indexCount = static_cast<GLsizei>(indexStorage.size());
+}
+
+// ===============================================================================================================
+// Simplification
+// ===============================================================================================================
+
+vgl::SharedOwnedMeshData vgl::simplify(const MeshData &data, GLfloat triangleRatio, GLfloat *error)
+{
+    if (data.vertices == nullptr || data.normals == nullptr || data.indices == nullptr || data.indexCount < 3) {
+        return nullptr;
+    }
+
+    internal::Simplifier simplifier(data);
+    std::size_t target = static_cast<std::size_t>(std::max(0.0f, triangleRatio) * (data.indexCount / 3));
+    double quadricError = simplifier.run(target);
+    if (error != nullptr) {
+        // the quadric error is a sum of squared plane distances
+        *error = static_cast<GLfloat>(std::sqrt(quadricError));
+    }
+    return simplifier.result();
+}
+
+void vgl::generateLods(MeshData &data, std::size_t levelCount, GLfloat triangleRatio)
+{
+    data.lods.clear();
+
+    const MeshData* previous = &data;
+    GLfloat error = 0.0f;
+    for (std::size_t level = 0; level < levelCount; ++level) {
+        GLfloat levelError = 0.0f;
+        SharedOwnedMeshData lod = simplify(*previous, triangleRatio, &levelError);
+        if (lod == nullptr || lod->indexCount == 0 || lod->indexCount > previous->indexCount * 9 / 10) {
+            break;
+        }
+
+        // each level is simplified from the previous one, so the errors add up
+        error += levelError;
+        lod->bounds = data.bounds;
+        data.lods.push_back(MeshLod{lod, error});
+        previous = lod.get();
+    }
+}
+
+// ===============================================================================================================
+// Optimization
+// ===============================================================================================================
+
+namespace vgl::internal {
+    constexpr std::size_t _forsythCacheSize = 32;
+    // triangles after which a cluster may end for overdraw ordering
+    constexpr std::size_t _minClusterTriangles = 16;
+
+    // Forsyth, "Linear-Speed Vertex Cache Optimisation"
+    GLfloat forsythScore(std::size_t cachePosition, std::size_t remainingTriangles)
+    {
+        if (remainingTriangles == 0) {
+            return -1.0f;
+        }
+        GLfloat score = 0.0f;
+        if (cachePosition < 3) {
+            // the last triangle is in the cache anyway, do not prefer its vertices
+            score = 0.75f;
+        } else if (cachePosition < _forsythCacheSize) {
+            GLfloat scale = 1.0f / (_forsythCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scale, 1.5f);
+        }
+        // vertices with few triangles left are finished first, so they do not linger
+        return score + 2.0f * std::pow(static_cast<GLfloat>(remainingTriangles), -0.5f);
+    }
+
+    // reorders the triangles in [first, last) of indices
+    void forsythReorder(std::vector<GLuint>& indices, std::size_t first, std::size_t last, std::size_t vertexCount)
+    {
+        std::size_t triangleCount = (last - first) / 3;
+        if (triangleCount < 2) {
+            return;
+        }
+        const GLuint* triangles = indices.data() + first;
+
+        std::vector<std::uint32_t> remaining(vertexCount, 0);
+        for (std::size_t i = 0; i < triangleCount * 3; ++i) {
+            ++remaining[triangles[i]];
+        }
+        std::vector<std::uint32_t> adjacencyOffset(vertexCount + 1, 0);
+        for (std::size_t v = 0; v < vertexCount; ++v) {
+            adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+        }
+        std::vector<std::uint32_t> adjacency(triangleCount * 3);
+        std::vector<std::uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (std::size_t t = 0; t < triangleCount; ++t) {
+            for (std::size_t corner = 0; corner < 3; ++corner) {
+                adjacency[fill[triangles[3 * t + corner]]++] = static_cast<std::uint32_t>(t);
+            }
+        }
+
+        std::vector<GLfloat> vertexScore(vertexCount, 0.0f);
+        for (std::size_t v = 0; v < vertexCount; ++v) {
+            vertexScore[v] = forsythScore(_forsythCacheSize, remaining[v]);
+        }
+        std::vector<GLfloat> triangleScore(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        for (std::size_t t = 0; t < triangleCount; ++t) {
+            triangleScore[t] = vertexScore[triangles[3 * t]] + vertexScore[triangles[3 * t + 1]] + vertexScore[triangles[3 * t + 2]];
+        }
+
+        std::vector<GLuint> result;
+        result.reserve(triangleCount * 3);
+        std::vector<GLuint> cache;
+        std::size_t scan = 0;
+        std::size_t best = 0;
+        for (std::size_t t = 1; t < triangleCount; ++t) {
+            if (triangleScore[t] > triangleScore[best]) {
+                best = t;
+            }
+        }
+
+        for (std::size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+            emitted[best] = true;
+            std::array<GLuint, 3> triangle = {triangles[3 * best], triangles[3 * best + 1], triangles[3 * best + 2]};
+            result.insert(result.end(), triangle.begin(), triangle.end());
+
+            // the new triangle's vertices go to the front of the LRU cache
+            std::vector<GLuint> newCache(triangle.begin(), triangle.end());
+            for (GLuint v : cache) {
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                    newCache.push_back(v);
+                }
+            }
+            for (GLuint v : triangle) {
+                --remaining[v];
+                auto begin = adjacency.begin() + adjacencyOffset[v];
+                auto end = begin + remaining[v] + 1;
+                std::uint32_t local = static_cast<std::uint32_t>(best);
+                std::iter_swap(std::find(begin, end, local), end - 1);
+            }
+            if (newCache.size() > _forsythCacheSize + 3) {
+                newCache.resize(_forsythCacheSize + 3);
+            }
+            cache.swap(newCache);
+
+            // rescore the cached vertices and the triangles around them, then pick the best of those
+            GLfloat bestScore = -1.0f;
+            for (std::size_t i = 0; i < cache.size(); ++i) {
+                GLuint v = cache[i];
+                GLfloat score = forsythScore(i < _forsythCacheSize ? i : _forsythCacheSize, remaining[v]);
+                GLfloat delta = score - vertexScore[v];
+                vertexScore[v] = score;
+                for (std::uint32_t j = 0; j < remaining[v]; ++j) {
+                    std::uint32_t adjacent = adjacency[adjacencyOffset[v] + j];
+                    triangleScore[adjacent] += delta;
+                }
+            }
+            for (GLuint v : cache) {
+                for (std::uint32_t j = 0; j < remaining[v]; ++j) {
+                    std::uint32_t adjacent = adjacency[adjacencyOffset[v] + j];
+                    if (triangleScore[adjacent] > bestScore) {
+                        bestScore = triangleScore[adjacent];
+                        best = adjacent;
+                    }
+                }
+            }
+            if (cache.size() > _forsythCacheSize) {
+                cache.resize(_forsythCacheSize);
+            }
+
+            // nothing adjacent to the cache is left, continue with the next unused triangle
+            if (bestScore < 0.0f) {
+                while (scan < triangleCount && emitted[scan]) {
+                    ++scan;
+                }
+                best = scan;
+            }
+        }
+
+        std::copy(result.begin(), result.end(), indices.begin() + first);
+    }
+
+    // material ranges as [first, last) index offsets
+    std::vector<std::pair<std::size_t, std::size_t>> materialRanges(const MeshData& data)
+    {
+        std::vector<std::pair<std::size_t, std::size_t>> ranges;
+        std::size_t first = 0;
+        for (GLsizei count : data.matTriangleCount) {
+            ranges.emplace_back(first, first + 3 * count);
+            first += 3 * count;
+        }
+        if (first < static_cast<std::size_t>(data.indexCount)) {
+            ranges.emplace_back(first, data.indexCount);
+        }
+        return ranges;
+    }
+} // namespace vgl::internal
+
+vgl::VertexCacheStats vgl::analyzeVertexCache(const MeshData &data, std::size_t cacheSize)
+{
+    VertexCacheStats stats;
+    std::size_t vertexCount = data.vertexCount / 3;
+    if (data.indices == nullptr || data.indexCount < 3 || vertexCount == 0) {
+        return stats;
+    }
+
+    // FIFO like most hardware, with a timestamp per vertex instead of an actual queue
+    std::vector<std::size_t> insertedAt(vertexCount, 0);
+    std::vector<bool> cached(vertexCount, false);
+    std::size_t misses = 0;
+    for (GLsizei i = 0; i < data.indexCount; ++i) {
+        GLuint v = data.indices[i];
+        if (!cached[v] || misses - insertedAt[v] >= cacheSize) {
+            cached[v] = true;
+            insertedAt[v] = misses;
+            ++misses;
+        }
+    }
+
+    stats.acmr = static_cast<GLfloat>(misses) / (data.indexCount / 3);
+    stats.atvr = static_cast<GLfloat>(misses) / vertexCount;
+    return stats;
+}
+
+vgl::SharedOwnedMeshData vgl::weldVertices(const MeshData &data)
+{
+    SharedOwnedMeshData result = std::make_shared<OwnedMeshData>();
+    result->materials = data.materials;
+    result->matTriangleCount = data.matTriangleCount;
+    result->quantize = data.quantize;
+    result->usage = data.usage;
+    result->bounds = data.bounds;
+    result->lods = data.lods;
+    // the indices keep their order, so the meshlet ranges stay valid
+    result->meshlets = data.meshlets;
+
+    std::size_t vertexCount = data.vertexCount / 3;
+    std::map<std::array<GLfloat, 6>, GLuint> unique;
+    std::vector<GLuint> remap(vertexCount);
+    for (std::size_t v = 0; v < vertexCount; ++v) {
+        std::array<GLfloat, 6> key = {
+            data.vertices[3 * v], data.vertices[3 * v + 1], data.vertices[3 * v + 2],
+            data.normals[3 * v], data.normals[3 * v + 1], data.normals[3 * v + 2]};
+        auto [it, inserted] = unique.emplace(key, static_cast<GLuint>(unique.size()));
+        if (inserted) {
+            result->vertexStorage.insert(result->vertexStorage.end(), key.begin(), key.begin() + 3);
+            result->normalStorage.insert(result->normalStorage.end(), key.begin() + 3, key.end());
+        }
+        remap[v] = it->second;
+    }
+
+    result->indexStorage.resize(data.indexCount);
+    for (GLsizei i = 0; i < data.indexCount; ++i) {
+        result->indexStorage[i] = remap[data.indices[i]];
+    }
+    result->bindStorage();
+    return result;
+}
+
+void vgl::optimizeVertexCache(OwnedMeshData &data)
+{
+    for (const auto& [first, last] : internal::materialRanges(data)) {
+        internal::forsythReorder(data.indexStorage, first, last, data.vertexStorage.size() / 3);
+    }
+    data.bindStorage();
+}
+
+void vgl::optimizeOverdraw(OwnedMeshData &data)
+{
+    using internal::dvec3;
+
+    std::vector<dvec3> positions(data.vertexStorage.size() / 3);
+    dvec3 meshCenter{0.0, 0.0, 0.0};
+    for (std::size_t v = 0; v < positions.size(); ++v) {
+        positions[v] = {data.vertexStorage[3 * v], data.vertexStorage[3 * v + 1], data.vertexStorage[3 * v + 2]};
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            meshCenter[axis] += positions[v][axis] / positions.size();
+        }
+    }
+
+    for (const auto& [first, last] : internal::materialRanges(data)) {
+        // clusters end where the cache order jumps to a new region, a triangle missing with all three vertices
+        std::vector<std::size_t> clusterStarts{first};
+        std::vector<std::size_t> insertedAt(positions.size(), 0);
+        std::vector<bool> cached(positions.size(), false);
+        std::size_t misses = 0;
+        for (std::size_t i = first; i < last; i += 3) {
+            std::size_t triangleMisses = 0;
+            for (std::size_t corner = 0; corner < 3; ++corner) {
+                GLuint v = data.indexStorage[i + corner];
+                if (!cached[v] || misses - insertedAt[v] >= 16) {
+                    cached[v] = true;
+                    insertedAt[v] = misses++;
+                    ++triangleMisses;
+                }
+            }
+            if (triangleMisses == 3 && i - clusterStarts.back() >= 3 * internal::_minClusterTriangles) {
+                clusterStarts.push_back(i);
+            }
+        }
+        if (clusterStarts.size() < 2) {
+            continue;
+        }
+        clusterStarts.push_back(last);
+
+        // Sander et al., clusters facing away from the center are likely in front, draw them first
+        std::vector<std::pair<double, std::size_t>> order;
+        for (std::size_t c = 0; c + 1 < clusterStarts.size(); ++c) {
+            dvec3 center{0.0, 0.0, 0.0};
+            dvec3 normal{0.0, 0.0, 0.0};
+            double area = 0.0;
+            for (std::size_t i = clusterStarts[c]; i < clusterStarts[c + 1]; i += 3) {
+                const dvec3& a = positions[data.indexStorage[i]];
+                const dvec3& b = positions[data.indexStorage[i + 1]];
+                const dvec3& d = positions[data.indexStorage[i + 2]];
+                dvec3 n = internal::cross(internal::sub(b, a), internal::sub(d, a));
+                double triangleArea = std::sqrt(internal::dot(n, n));
+                for (std::size_t axis = 0; axis < 3; ++axis) {
+                    center[axis] += (a[axis] + b[axis] + d[axis]) / 3.0 * triangleArea;
+                    normal[axis] += n[axis];
+                }
+                area += triangleArea;
+            }
+            if (area > 0.0) {
+                for (double& value : center) {
+                    value /= area;
+                }
+            }
+            double outwardness = internal::dot(internal::sub(center, meshCenter), internal::normalized(normal));
+            order.emplace_back(-outwardness, c);
+        }
+        std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        std::vector<GLuint> sorted;
+        sorted.reserve(last - first);
+        for (const auto& [key, c] : order) {
+            sorted.insert(sorted.end(), data.indexStorage.begin() + clusterStarts[c], data.indexStorage.begin() + clusterStarts[c + 1]);
+        }
+        std::copy(sorted.begin(), sorted.end(), data.indexStorage.begin() + first);
+    }
+    data.bindStorage();
+}
+
+void vgl::optimizeVertexFetch(OwnedMeshData &data)
+{
+    std::size_t vertexCount = data.vertexStorage.size() / 3;
+    std::vector<GLuint> remap(vertexCount, ~GLuint(0));
+    std::vector<GLfloat> vertices;
+    std::vector<GLfloat> normals;
+    vertices.reserve(data.vertexStorage.size());
+    normals.reserve(data.normalStorage.size());
+
+    for (GLuint& index : data.indexStorage) {
+        if (remap[index] == ~GLuint(0)) {
+            remap[index] = static_cast<GLuint>(vertices.size() / 3);
+            vertices.insert(vertices.end(), data.vertexStorage.begin() + 3 * index, data.vertexStorage.begin() + 3 * index + 3);
+            normals.insert(normals.end(), data.normalStorage.begin() + 3 * index, data.normalStorage.begin() + 3 * index + 3);
+        }
+        index = remap[index];
+    }
+
+    // unreferenced vertices are dropped
+    data.vertexStorage.swap(vertices);
+    data.normalStorage.swap(normals);
+    data.bindStorage();
+}
+
+vgl::SharedOwnedMeshData vgl::optimizeMesh(const MeshData &data, MeshOptimizationReport *report)
+{
+    if (data.vertices == nullptr || data.normals == nullptr || data.indices == nullptr || data.indexCount < 3) {
+        return nullptr;
+    }
+
+    SharedOwnedMeshData result = weldVertices(data);
+    optimizeVertexCache(*result);
+    optimizeOverdraw(*result);
+    optimizeVertexFetch(*result);
+    // the triangles were reordered, meshlets have to be built again on the result
+    result->meshlets.clear();
+
+    if (report != nullptr) {
+        report->before = analyzeVertexCache(data);
+        report->after = analyzeVertexCache(*result);
+        report->verticesBefore = data.vertexCount / 3;
+        report->verticesAfter = result->vertexCount / 3;
+    }
+    return result;
+}
+
+// ===============================================================================================================
+// Meshlets
+// ===============================================================================================================
+
+namespace vgl::internal {
+    // triangles whose normals are more than about 84 degrees from the axis leave the cone without culling power
+    constexpr GLfloat _minConeDot = 0.1f;
+
+    NormalCone normalCone(const MeshData& data, const std::vector<GLuint>& indices)
+    {
+        std::vector<dvec3> normals;
+        dvec3 sum{0.0, 0.0, 0.0};
+        for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+            dvec3 a{data.vertices[3 * indices[i]], data.vertices[3 * indices[i] + 1], data.vertices[3 * indices[i] + 2]};
+            dvec3 b{data.vertices[3 * indices[i + 1]], data.vertices[3 * indices[i + 1] + 1], data.vertices[3 * indices[i + 1] + 2]};
+            dvec3 c{data.vertices[3 * indices[i + 2]], data.vertices[3 * indices[i + 2] + 1], data.vertices[3 * indices[i + 2] + 2]};
+            dvec3 normal = normalized(cross(sub(b, a), sub(c, a)));
+            // degenerate triangles are never visible
+            if (dot(normal, normal) == 0.0) {
+                continue;
+            }
+            normals.push_back(normal);
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                sum[axis] += normal[axis];
+            }
+        }
+
+        NormalCone cone;
+        dvec3 axis = normalized(sum);
+        if (normals.empty() || dot(axis, axis) == 0.0) {
+            return cone;
+        }
+        double minDot = 1.0;
+        for (const dvec3& normal : normals) {
+            minDot = std::min(minDot, dot(normal, axis));
+        }
+        if (minDot <= _minConeDot) {
+            return cone;
+        }
+        cone.axis = {static_cast<GLfloat>(axis[0]), static_cast<GLfloat>(axis[1]), static_cast<GLfloat>(axis[2])};
+        cone.cutoff = static_cast<GLfloat>(std::sqrt(1.0 - minDot * minDot));
+        return cone;
+    }
+} // namespace vgl::internal
+
+vgl::SharedOwnedMeshData vgl::buildMeshlets(const MeshData &data, std::size_t maxVertices, std::size_t maxTriangles)
+{
+    if (data.vertices == nullptr || data.indices == nullptr || data.indexCount < 3 || maxVertices < 3 || maxTriangles < 1) {
+        return nullptr;
+    }
+
+    SharedOwnedMeshData result = std::make_shared<OwnedMeshData>();
+    result->vertexStorage.assign(data.vertices, data.vertices + data.vertexCount);
+    if (data.normals != nullptr) {
+        result->normalStorage.assign(data.normals, data.normals + data.vertexCount);
+    }
+    result->materials = data.materials;
+    result->matTriangleCount = data.matTriangleCount;
+    result->quantize = data.quantize;
+    result->usage = data.usage;
+    result->bounds = data.bounds;
+    result->lods = data.lods;
+    result->indexStorage.reserve(data.indexCount);
+
+    std::size_t vertexCount = data.vertexCount / 3;
+    // stamp of the meshlet a vertex was last added to, so the vertex sets need no clearing
+    std::vector<std::size_t> vertexMeshlet(vertexCount, ~std::size_t(0));
+    std::size_t meshletId = 0;
+
+    auto ranges = internal::materialRanges(data);
+    for (std::size_t material = 0; material < ranges.size(); ++material) {
+        std::size_t first = ranges[material].first;
+        std::size_t triangleCount = (ranges[material].second - first) / 3;
+        if (triangleCount == 0) {
+            continue;
+        }
+
+        // triangles around each vertex, local to the material range
+        std::unordered_map<GLuint, std::vector<std::uint32_t>> adjacency;
+        for (std::size_t t = 0; t < triangleCount; ++t) {
+            for (std::size_t corner = 0; corner < 3; ++corner) {
+                adjacency[data.indices[first + 3 * t + corner]].push_back(static_cast<std::uint32_t>(t));
+            }
+        }
+
+        std::vector<bool> used(triangleCount, false);
+        std::size_t scan = 0;
+        std::vector<std::uint32_t> candidates;
+        std::vector<GLuint> vertices;
+        std::vector<GLuint> indices;
+        while (true) {
+            while (scan < triangleCount && used[scan]) {
+                ++scan;
+            }
+            if (scan == triangleCount) {
+                break;
+            }
+
+            vertices.clear();
+            indices.clear();
+            candidates.clear();
+            ++meshletId;
+            auto newVertices = [&](std::uint32_t t) {
+                std::size_t count = 0;
+                for (std::size_t corner = 0; corner < 3; ++corner) {
+                    count += vertexMeshlet[data.indices[first + 3 * t + corner]] != meshletId ? 1 : 0;
+                }
+                return count;
+            };
+            auto add = [&](std::uint32_t t) {
+                used[t] = true;
+                for (std::size_t corner = 0; corner < 3; ++corner) {
+                    GLuint v = data.indices[first + 3 * t + corner];
+                    indices.push_back(v);
+                    if (vertexMeshlet[v] != meshletId) {
+                        vertexMeshlet[v] = meshletId;
+                        vertices.push_back(v);
+                        for (std::uint32_t adjacent : adjacency[v]) {
+                            if (!used[adjacent]) {
+                                candidates.push_back(adjacent);
+                            }
+                        }
+                    }
+                }
+            };
+
+            // greedy growth over shared edges and vertices, preferring triangles that add the fewest vertices
+            add(static_cast<std::uint32_t>(scan));
+            while (indices.size() / 3 < maxTriangles) {
+                std::size_t best = ~std::size_t(0);
+                std::size_t bestNew = 4;
+                for (std::size_t i = 0; i < candidates.size();) {
+                    if (used[candidates[i]]) {
+                        candidates[i] = candidates.back();
+                        candidates.pop_back();
+                        continue;
+                    }
+                    std::size_t count = newVertices(candidates[i]);
+                    if (count < bestNew && vertices.size() + count <= maxVertices) {
+                        best = i;
+                        bestNew = count;
+                        if (count == 0) {
+                            break;
+                        }
+                    }
+                    ++i;
+                }
+                if (best == ~std::size_t(0)) {
+                    break;
+                }
+                add(candidates[best]);
+            }
+
+            Meshlet meshlet;
+            meshlet.firstIndex = static_cast<GLuint>(result->indexStorage.size());
+            meshlet.indexCount = static_cast<GLsizei>(indices.size());
+            meshlet.materialIndex = static_cast<std::uint32_t>(material);
+
+            std::vector<GLfloat> positions;
+            positions.reserve(3 * vertices.size());
+            for (GLuint v : vertices) {
+                positions.insert(positions.end(), data.vertices + 3 * v, data.vertices + 3 * v + 3);
+            }
+            meshlet.bounds = computeBounds(positions.data(), static_cast<GLsizei>(positions.size()));
+            meshlet.cone = internal::normalCone(data, indices);
+
+            result->indexStorage.insert(result->indexStorage.end(), indices.begin(), indices.end());
+            result->meshlets.push_back(meshlet);
+        }
+    }
+
+    result->bindStorage();
+    return result;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <vgl/renderer.h>
+
+
+namespace vgl {
+
+// ===============================================================================================================
+// OwnedMeshData
+// ===============================================================================================================
+// mesh data that owns its arrays, the pointers of MeshData point into the storage vectors
+struct OwnedMeshData : MeshData {
+    OwnedMeshData() = default;
+    OwnedMeshData(const OwnedMeshData&) = delete;
+    OwnedMeshData& operator=(const OwnedMeshData&) = delete;
+
+    std::vector<GLfloat> vertexStorage{};
+    std::vector<GLfloat> normalStorage{};
+    std::vector<GLuint> indexStorage{};
+
+    // updates the MeshData pointers and counts after the storage has changed
+    void bindStorage();
+};
+
+using SharedOwnedMeshData = std::shared_ptr<OwnedMeshData>;
+
+// ===============================================================================================================
+// Simplification
+// ===============================================================================================================
+// quadric error metric edge collapse (Garland and Heckbert), vertices are only moved onto their neighbours,
+// so the normals of the result are those of the source. Triangles stay in their material ranges and
+// borders of the mesh and between materials are preserved by constraint quadrics.
+// error receives the approximate geometric deviation in object space
+SharedOwnedMeshData simplify(const MeshData& data, GLfloat triangleRatio, GLfloat* error = nullptr);
+
+// fills data.lods with up to levelCount coarser levels, each with about triangleRatio of the triangles of
+// the previous one, stops early when a level would not remove at least a tenth of the triangles
+void generateLods(MeshData& data, std::size_t levelCount = 4, GLfloat triangleRatio = 0.5f);
+
+// ===============================================================================================================
+// Optimization
+// ===============================================================================================================
+// average cache miss ratio per triangle and per vertex of a simulated FIFO post transform cache,
+// ACMR is at best about 0.5 for large regular meshes, ATVR at best 1.0
+struct VertexCacheStats {
+    GLfloat acmr = 0.0f;
+    GLfloat atvr = 0.0f;
+};
+
+struct MeshOptimizationReport {
+    VertexCacheStats before{};
+    VertexCacheStats after{};
+    GLsizei verticesBefore = 0;
+    GLsizei verticesAfter = 0;
+};
+
+VertexCacheStats analyzeVertexCache(const MeshData& data, std::size_t cacheSize = 16);
+
+// merges vertices with equal positions and normals, usage, levels of detail and meshlets are kept
+SharedOwnedMeshData weldVertices(const MeshData& data);
+
+// reorders the triangles of each material range for the post transform cache (Forsyth), then orders
+// clusters of them so that outward facing parts are drawn first and occlude the rest
+void optimizeVertexCache(OwnedMeshData& data);
+void optimizeOverdraw(OwnedMeshData& data);
+// renumbers the vertices in the order of their first use, so vertex fetches walk linearly through memory
+void optimizeVertexFetch(OwnedMeshData& data);
+
+// all of the above, the result renders the same triangles with the same materials and keeps the usage and
+// levels of detail of data. Meshlets are dropped since the triangle order changes
+SharedOwnedMeshData optimizeMesh(const MeshData& data, MeshOptimizationReport* report = nullptr);
+
+// ===============================================================================================================
+// Meshlets
+// ===============================================================================================================
+// splits every material range into meshlets of connected triangles with at most maxVertices distinct vertices
+// and maxTriangles triangles, the indices of the result are reordered so that each meshlet is one index range.
+// The levels of detail are kept but get no meshlets of their own, call this on their data for that
+constexpr std::size_t MaxMeshletVertices = 64;
+constexpr std::size_t MaxMeshletTriangles = 124;
+
+SharedOwnedMeshData buildMeshlets(const MeshData& data, std::size_t maxVertices = MaxMeshletVertices,
+                                  std::size_t maxTriangles = MaxMeshletTriangles);
+
+} // namespace vgl
@@ -0,0 +1,343 @@
+#include <vgl/occlusion.h>
+#include <vgl/jobs.h>
+#include <vgl/vecmath.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VGL_OCCLUSION_SSE2 1
+#endif
+
+
+namespace vgl::internal {
+    constexpr GLfloat _emptyDepth = std::numeric_limits<GLfloat>::max();
+    // clip space w below which a vertex counts as behind the near plane
+    constexpr GLfloat _minClipW = 1e-4f;
+
+    std::array<GLfloat, 4> transformPoint(const std::array<std::array<GLfloat, 4>, 4>& m, GLfloat x, GLfloat y, GLfloat z)
+    {
+        return {
+            m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3],
+            m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3],
+            m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3],
+            m[3][0] * x + m[3][1] * y + m[3][2] * z + m[3][3]};
+    }
+} // namespace vgl::internal
+
+// ===============================================================================================================
+// OcclusionBuffer
+// ===============================================================================================================
+
+vgl::OcclusionBuffer::OcclusionBuffer()
+{
+    setResolution(256, 128);
+    setThreadCount(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+void vgl::OcclusionBuffer::setResolution(std::size_t width, std::size_t height)
+{
+    mTilesX = std::max<std::size_t>(1, (width + TileWidth - 1) / TileWidth);
+    mTilesY = std::max<std::size_t>(1, (height + TileHeight - 1) / TileHeight);
+    mWidth = mTilesX * TileWidth;
+    mHeight = mTilesY * TileHeight;
+
+    mDepth.assign(mWidth * mHeight, internal::_emptyDepth);
+    mBlockDepth.assign((mWidth / BlockSize) * (mHeight / BlockSize), internal::_emptyDepth);
+    mBins.assign(mTilesX * mTilesY, {});
+}
+
+std::size_t vgl::OcclusionBuffer::width() const
+{
+    return mWidth;
+}
+
+std::size_t vgl::OcclusionBuffer::height() const
+{
+    return mHeight;
+}
+
+void vgl::OcclusionBuffer::setThreadCount(std::size_t count)
+{
+    mThreadCount = std::max<std::size_t>(1, count);
+}
+
+std::size_t vgl::OcclusionBuffer::threadCount() const
+{
+    return mThreadCount;
+}
+
+void vgl::OcclusionBuffer::begin(const std::array<std::array<GLfloat, 4>, 4> &viewProjection)
+{
+    mViewProjection = viewProjection;
+    mTriangles.clear();
+    for (auto& bin : mBins) {
+        bin.clear();
+    }
+}
+
+void vgl::OcclusionBuffer::addOccluder(const GLfloat *vertices, GLsizei vertexCount, const GLuint *indices, GLsizei indexCount,
+                                       const std::array<std::array<GLfloat, 4>, 4> &model)
+{
+    if (vertices == nullptr || indices == nullptr) {
+        return;
+    }
+
+    math::Mat4 modelViewProjection = math::toMat4(mViewProjection) * math::toMat4(model);
+
+    // screen space positions, w is kept to reject triangles behind the near plane
+    std::vector<std::array<GLfloat, 4>> screen(vertexCount / 3);
+    math::transformPoints(modelViewProjection, vertices, screen.size(), reinterpret_cast<GLfloat*>(screen.data()));
+    for (std::size_t v = 0; v < screen.size(); ++v) {
+        std::array<GLfloat, 4> clip = screen[v];
+        if (clip[3] < internal::_minClipW) {
+            screen[v] = {0.0f, 0.0f, 0.0f, clip[3]};
+            continue;
+        }
+        GLfloat inverseW = 1.0f / clip[3];
+        screen[v] = {
+            (clip[0] * inverseW * 0.5f + 0.5f) * mWidth,
+            (clip[1] * inverseW * 0.5f + 0.5f) * mHeight,
+            clip[2] * inverseW,
+            clip[3]};
+    }
+
+    for (GLsizei i = 0; i + 2 < indexCount; i += 3) {
+        const auto& a = screen[indices[i]];
+        const auto& b = screen[indices[i + 1]];
+        const auto& c = screen[indices[i + 2]];
+        if (a[3] < internal::_minClipW || b[3] < internal::_minClipW || c[3] < internal::_minClipW) {
+            continue;
+        }
+
+        GLfloat minX = std::min({a[0], b[0], c[0]});
+        GLfloat maxX = std::max({a[0], b[0], c[0]});
+        GLfloat minY = std::min({a[1], b[1], c[1]});
+        GLfloat maxY = std::max({a[1], b[1], c[1]});
+        if (maxX < 0.0f || maxY < 0.0f || minX >= mWidth || minY >= mHeight) {
+            continue;
+        }
+
+        auto index = static_cast<std::uint32_t>(mTriangles.size());
+        mTriangles.push_back(Triangle{{a[0], b[0], c[0]}, {a[1], b[1], c[1]}, {a[2], b[2], c[2]}});
+
+        std::size_t firstTileX = static_cast<std::size_t>(std::max(minX, 0.0f)) / TileWidth;
+        std::size_t lastTileX = std::min(static_cast<std::size_t>(maxX) / TileWidth, mTilesX - 1);
+        std::size_t firstTileY = static_cast<std::size_t>(std::max(minY, 0.0f)) / TileHeight;
+        std::size_t lastTileY = std::min(static_cast<std::size_t>(maxY) / TileHeight, mTilesY - 1);
+        for (std::size_t tileY = firstTileY; tileY <= lastTileY; ++tileY) {
+            for (std::size_t tileX = firstTileX; tileX <= lastTileX; ++tileX) {
+                mBins[tileY * mTilesX + tileX].push_back(index);
+            }
+        }
+    }
+}
+
+void vgl::OcclusionBuffer::rasterize()
+{
+    // tiles do not share pixels, so the workers only synchronize on the next tile to take
+    std::atomic<std::size_t> nextTile{0};
+    auto work = [this, &nextTile]() {
+        for (std::size_t tile = nextTile++; tile < mBins.size(); tile = nextTile++) {
+            rasterizeTile(tile);
+        }
+    };
+
+    std::vector<JobHandle> workers;
+    for (std::size_t i = 1; i < std::min(mThreadCount, mBins.size()); ++i) {
+        workers.push_back(jobSystem().run(work));
+    }
+    work();
+    for (const JobHandle& worker : workers) {
+        jobSystem().wait(worker);
+    }
+}
+
+bool vgl::OcclusionBuffer::occluded(const Bounds &bounds) const
+{
+    if (!bounds.valid()) {
+        return false;
+    }
+
+    GLfloat minX = std::numeric_limits<GLfloat>::max();
+    GLfloat minY = std::numeric_limits<GLfloat>::max();
+    GLfloat maxX = std::numeric_limits<GLfloat>::lowest();
+    GLfloat maxY = std::numeric_limits<GLfloat>::lowest();
+    GLfloat nearest = std::numeric_limits<GLfloat>::max();
+    for (std::size_t corner = 0; corner < 8; ++corner) {
+        auto clip = internal::transformPoint(mViewProjection,
+            (corner & 1) ? bounds.max[0] : bounds.min[0],
+            (corner & 2) ? bounds.max[1] : bounds.min[1],
+            (corner & 4) ? bounds.max[2] : bounds.min[2]);
+        if (clip[3] < internal::_minClipW) {
+            return false;
+        }
+        GLfloat inverseW = 1.0f / clip[3];
+        GLfloat x = (clip[0] * inverseW * 0.5f + 0.5f) * mWidth;
+        GLfloat y = (clip[1] * inverseW * 0.5f + 0.5f) * mHeight;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        // depth is monotonic in the view distance, so the nearest point of the box is a corner
+        nearest = std::min(nearest, clip[2] * inverseW);
+    }
+
+    // every pixel the projected box touches
+    GLfloat clampedMinX = std::max(std::floor(minX), 0.0f);
+    GLfloat clampedMinY = std::max(std::floor(minY), 0.0f);
+    GLfloat clampedMaxX = std::min(std::ceil(maxX), static_cast<GLfloat>(mWidth));
+    GLfloat clampedMaxY = std::min(std::ceil(maxY), static_cast<GLfloat>(mHeight));
+    if (clampedMinX >= clampedMaxX || clampedMinY >= clampedMaxY) {
+        return false;
+    }
+    auto x0 = static_cast<std::size_t>(clampedMinX);
+    auto y0 = static_cast<std::size_t>(clampedMinY);
+    auto x1 = static_cast<std::size_t>(clampedMaxX);
+    auto y1 = static_cast<std::size_t>(clampedMaxY);
+
+    // blocks whose farthest occluder is in front of the box are done, the others are tested per pixel
+    std::size_t blocksX = mWidth / BlockSize;
+    for (std::size_t blockY = y0 / BlockSize; blockY <= (y1 - 1) / BlockSize; ++blockY) {
+        for (std::size_t blockX = x0 / BlockSize; blockX <= (x1 - 1) / BlockSize; ++blockX) {
+            if (mBlockDepth[blockY * blocksX + blockX] < nearest) {
+                continue;
+            }
+            std::size_t pixelX1 = std::min(x1, (blockX + 1) * BlockSize);
+            std::size_t pixelY1 = std::min(y1, (blockY + 1) * BlockSize);
+            for (std::size_t y = std::max(y0, blockY * BlockSize); y < pixelY1; ++y) {
+                for (std::size_t x = std::max(x0, blockX * BlockSize); x < pixelX1; ++x) {
+                    if (mDepth[y * mWidth + x] >= nearest) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+GLfloat vgl::OcclusionBuffer::depth(std::size_t x, std::size_t y) const
+{
+    return mDepth[y * mWidth + x];
+}
+
+void vgl::OcclusionBuffer::rasterizeTile(std::size_t tile)
+{
+    std::size_t tileX = tile % mTilesX;
+    std::size_t tileY = tile / mTilesX;
+    for (std::size_t y = tileY * TileHeight; y < (tileY + 1) * TileHeight; ++y) {
+        std::fill_n(mDepth.begin() + y * mWidth + tileX * TileWidth, TileWidth, internal::_emptyDepth);
+    }
+
+    for (std::uint32_t index : mBins[tile]) {
+        rasterizeTriangle(mTriangles[index], tileX, tileY);
+    }
+
+    std::size_t blocksX = mWidth / BlockSize;
+    for (std::size_t blockY = tileY * TileHeight / BlockSize; blockY < (tileY + 1) * TileHeight / BlockSize; ++blockY) {
+        for (std::size_t blockX = tileX * TileWidth / BlockSize; blockX < (tileX + 1) * TileWidth / BlockSize; ++blockX) {
+            GLfloat farthest = 0.0f;
+            for (std::size_t y = blockY * BlockSize; y < (blockY + 1) * BlockSize; ++y) {
+                const GLfloat* row = mDepth.data() + y * mWidth + blockX * BlockSize;
+                farthest = std::max(farthest, *std::max_element(row, row + BlockSize));
+            }
+            mBlockDepth[blockY * blocksX + blockX] = farthest;
+        }
+    }
+}
+
+void vgl::OcclusionBuffer::rasterizeTriangle(const Triangle &triangle, std::size_t tileX, std::size_t tileY)
+{
+    std::array<GLfloat, 3> x = triangle.x;
+    std::array<GLfloat, 3> y = triangle.y;
+    std::array<GLfloat, 3> z = triangle.z;
+
+    // both windings are rasterized, clockwise triangles are flipped to counter clockwise
+    GLfloat area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (std::abs(area) < 1e-8f) {
+        return;
+    }
+    if (area < 0.0f) {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        area = -area;
+    }
+
+    // edge i is opposite of vertex i and positive inside, e = a * px + b * py + c
+    std::array<GLfloat, 3> a, b, c;
+    for (std::size_t i = 0; i < 3; ++i) {
+        std::size_t from = (i + 1) % 3;
+        std::size_t to = (i + 2) % 3;
+        a[i] = y[from] - y[to];
+        b[i] = x[to] - x[from];
+        c[i] = -(a[i] * x[from] + b[i] * y[from]);
+    }
+    // the edge functions are unnormalized barycentric coordinates, which interpolate the depth
+    GLfloat inverseArea = 1.0f / area;
+    GLfloat depthA = (a[0] * z[0] + a[1] * z[1] + a[2] * z[2]) * inverseArea;
+    GLfloat depthB = (b[0] * z[0] + b[1] * z[1] + b[2] * z[2]) * inverseArea;
+    GLfloat depthC = (c[0] * z[0] + c[1] * z[1] + c[2] * z[2]) * inverseArea;
+
+    // bounding box within the tile, columns start on a multiple of 4 for the SIMD loop
+    GLfloat tileMinX = static_cast<GLfloat>(tileX * TileWidth);
+    GLfloat tileMinY = static_cast<GLfloat>(tileY * TileHeight);
+    GLfloat minX = std::max(std::floor(std::min({x[0], x[1], x[2]})), tileMinX);
+    GLfloat maxX = std::min(std::ceil(std::max({x[0], x[1], x[2]})), tileMinX + TileWidth);
+    GLfloat minY = std::max(std::floor(std::min({y[0], y[1], y[2]})), tileMinY);
+    GLfloat maxY = std::min(std::ceil(std::max({y[0], y[1], y[2]})), tileMinY + TileHeight);
+    if (minX >= maxX || minY >= maxY) {
+        return;
+    }
+    std::size_t x0 = static_cast<std::size_t>(minX) & ~std::size_t(3);
+    std::size_t x1 = static_cast<std::size_t>(maxX);
+    std::size_t y0 = static_cast<std::size_t>(minY);
+    std::size_t y1 = static_cast<std::size_t>(maxY);
+
+    #if defined(VGL_OCCLUSION_SSE2)
+    __m128 zero = _mm_setzero_ps();
+    __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    __m128 edgeA0 = _mm_set1_ps(a[0]), edgeA1 = _mm_set1_ps(a[1]), edgeA2 = _mm_set1_ps(a[2]);
+    __m128 planeA = _mm_set1_ps(depthA);
+    for (std::size_t py = y0; py < y1; ++py) {
+        GLfloat centerY = py + 0.5f;
+        __m128 row0 = _mm_set1_ps(b[0] * centerY + c[0]);
+        __m128 row1 = _mm_set1_ps(b[1] * centerY + c[1]);
+        __m128 row2 = _mm_set1_ps(b[2] * centerY + c[2]);
+        __m128 rowDepth = _mm_set1_ps(depthB * centerY + depthC);
+        GLfloat* depthRow = mDepth.data() + py * mWidth;
+        for (std::size_t px = x0; px < x1; px += 4) {
+            __m128 centerX = _mm_add_ps(_mm_set1_ps(static_cast<GLfloat>(px)), offsets);
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(edgeA0, centerX), row0);
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(edgeA1, centerX), row1);
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(edgeA2, centerX), row2);
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+            if (_mm_movemask_ps(inside) == 0) {
+                continue;
+            }
+            __m128 depth = _mm_add_ps(_mm_mul_ps(planeA, centerX), rowDepth);
+            __m128 current = _mm_loadu_ps(depthRow + px);
+            __m128 nearer = _mm_min_ps(current, depth);
+            _mm_storeu_ps(depthRow + px, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+        }
+    }
+    #else
+    for (std::size_t py = y0; py < y1; ++py) {
+        GLfloat centerY = py + 0.5f;
+        GLfloat* depthRow = mDepth.data() + py * mWidth;
+        for (std::size_t px = x0; px < x1; ++px) {
+            GLfloat centerX = px + 0.5f;
+            if (a[0] * centerX + b[0] * centerY + c[0] < 0.0f || a[1] * centerX + b[1] * centerY + c[1] < 0.0f
+                || a[2] * centerX + b[2] * centerY + c[2] < 0.0f) {
+                continue;
+            }
+            depthRow[px] = std::min(depthRow[px], depthA * centerX + depthB * centerY + depthC);
+        }
+    }
+    #endif
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <vgl/gl.h>
+#include <vgl/culling.h>
+
+
+namespace vgl {
+
+// ===============================================================================================================
+// OcclusionBuffer
+// ===============================================================================================================
+// low resolution software depth buffer. Occluder triangles are binned into tiles that worker threads rasterize
+// 4 pixels at a time with SSE2, each tile is then reduced into a hierarchical depth buffer of 8x8 pixel blocks
+// which the bounding boxes of other meshes are tested against
+class OcclusionBuffer {
+public:
+    static constexpr std::size_t TileWidth = 64;
+    static constexpr std::size_t TileHeight = 32;
+    static constexpr std::size_t BlockSize = 8;
+
+    OcclusionBuffer();
+
+    // rounded up to multiples of the tile size
+    void setResolution(std::size_t width, std::size_t height);
+    std::size_t width() const;
+    std::size_t height() const;
+
+    // jobs rasterizing tiles on the job system, including the calling thread
+    void setThreadCount(std::size_t count);
+    std::size_t threadCount() const;
+
+    // clears the depth buffer and the occluders
+    void begin(const std::array<std::array<GLfloat, 4>, 4>& viewProjection);
+    // vertexCount is the number of floats, 3 per vertex, like in MeshData.
+    // triangles crossing the near plane are skipped, which only makes the buffer less occluding
+    void addOccluder(const GLfloat* vertices, GLsizei vertexCount, const GLuint* indices, GLsizei indexCount,
+                     const std::array<std::array<GLfloat, 4>, 4>& model);
+    void rasterize();
+
+    // true if the world space box of bounds is hidden behind the occluders,
+    // boxes crossing the near plane or leaving the screen entirely are never occluded
+    bool occluded(const Bounds& bounds) const;
+
+    // normalized device depth of the nearest occluder at a pixel, the maximum float if there is none
+    GLfloat depth(std::size_t x, std::size_t y) const;
+
+private:
+    // screen space, pixel centers are at half integers
+    struct Triangle {
+        std::array<GLfloat, 3> x;
+        std::array<GLfloat, 3> y;
+        std::array<GLfloat, 3> z;
+    };
+
+    void rasterizeTile(std::size_t tile);
+    void rasterizeTriangle(const Triangle& triangle, std::size_t tileX, std::size_t tileY);
+
+private:
+    std::size_t mWidth = 0;
+    std::size_t mHeight = 0;
+    std::size_t mTilesX = 0;
+    std::size_t mTilesY = 0;
+    std::size_t mThreadCount = 1;
+
+    std::array<std::array<GLfloat, 4>, 4> mViewProjection{};
+
+    std::vector<GLfloat> mDepth{};
+    // farthest depth of each block
+    std::vector<GLfloat> mBlockDepth{};
+
+    std::vector<Triangle> mTriangles{};
+    // triangles overlapping each tile
+    std::vector<std::vector<std::uint32_t>> mBins{};
+};
+
+} // namespace vgl
@@ -0,0 +1,149 @@
+#include <vgl/programcache.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+
+namespace vgl::internal {
+    const std::uint32_t _programCacheMagic = 0x50474c56; // "VGLP"
+    const std::uint32_t _programCacheVersion = 1;
+}
+
+// ===============================================================================================================
+// ProgramCache
+// ===============================================================================================================
+
+void vgl::ProgramCache::setDirectory(const std::string &directory)
+{
+    mDirectory = directory;
+}
+
+const std::string &vgl::ProgramCache::directory() const
+{
+    return mDirectory;
+}
+
+bool vgl::ProgramCache::enabled()
+{
+    if (mDirectory.empty()) {
+        return false;
+    }
+    if (mFormatCount < 0) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &mFormatCount);
+    }
+    return mFormatCount > 0;
+}
+
+bool vgl::ProgramCache::load(GLuint program, const std::string &key)
+{
+    if (!enabled()) {
+        return false;
+    }
+    std::uint64_t keyHash = hash(key);
+    std::ifstream file(path(keyHash), std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    Header header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(Header))
+        || header.magic != internal::_programCacheMagic || header.version != internal::_programCacheVersion
+        || header.keyHash != keyHash || header.driverHash != driverHash()) {
+        return false;
+    }
+    // the size comes from disk, a truncated or corrupt entry is dropped instead of allocated
+    std::streamoff start = file.tellg();
+    file.seekg(0, std::ios::end);
+    std::streamoff remaining = file.tellg() - start;
+    if (!file || header.size <= 0 || header.size > remaining) {
+        file.close();
+        std::error_code error;
+        std::filesystem::remove(path(keyHash), error);
+        return false;
+    }
+    file.seekg(start);
+    std::vector<char> binary(header.size);
+    if (!file.read(binary.data(), binary.size())) {
+        return false;
+    }
+
+    glProgramBinary(program, header.format, binary.data(), header.size);
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        return false;
+    }
+    ++mStats.loaded;
+    return true;
+}
+
+void vgl::ProgramCache::store(GLuint program, const std::string &key)
+{
+    ++mStats.compiled;
+    if (!enabled()) {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<char> binary(length);
+    Header header{internal::_programCacheMagic, internal::_programCacheVersion, hash(key), driverHash(), 0, 0};
+    glGetProgramBinary(program, static_cast<GLsizei>(length), &header.size, &header.format, binary.data());
+    if (header.size == 0) {
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(mDirectory, error);
+    // written to a temporary file first, so a crash never leaves a truncated entry behind
+    std::string entry = path(header.keyHash);
+    std::string temporary = entry + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(&header), sizeof(Header)) || !file.write(binary.data(), header.size)) {
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, entry, error);
+}
+
+vgl::ProgramCacheStats vgl::ProgramCache::stats() const
+{
+    return mStats;
+}
+
+std::uint64_t vgl::ProgramCache::hash(const std::string &string)
+{
+    // 64 bit FNV-1a
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c : string) {
+        hash = (hash ^ c) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+std::string vgl::ProgramCache::path(std::uint64_t keyHash) const
+{
+    std::ostringstream name;
+    name << std::hex << keyHash << ".bin";
+    return (std::filesystem::path(mDirectory) / name.str()).string();
+}
+
+std::uint64_t vgl::ProgramCache::driverHash()
+{
+    if (mDriverHash == 0) {
+        std::string driver;
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            const GLubyte* value = glGetString(name);
+            driver += value != nullptr ? reinterpret_cast<const char*>(value) : "";
+            driver += '\n';
+        }
+        mDriverHash = hash(driver);
+    }
+    return mDriverHash;
+}
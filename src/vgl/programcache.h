@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vgl/gl.h>
+
+
+namespace vgl {
+
+// ===============================================================================================================
+// ProgramCache
+// ===============================================================================================================
+struct ProgramCacheStats {
+    std::size_t loaded = 0;
+    std::size_t compiled = 0;
+};
+
+// linked program binaries on disk, one file per key. Keys are the complete shader sources including their
+// defines, the entries additionally remember the vendor, renderer and version of the driver that wrote them,
+// so a driver update or a shader change never loads a stale binary
+class ProgramCache {
+public:
+    ProgramCache() = default;
+    ProgramCache(const ProgramCache&) = delete;
+    ProgramCache& operator=(const ProgramCache&) = delete;
+
+    // an empty directory disables the cache, it is created on the first store()
+    void setDirectory(const std::string& directory);
+    const std::string& directory() const;
+    // false without a directory or if the driver supports no binary formats
+    bool enabled();
+
+    // rendering thread only. Links program from the stored binary, false if there is no entry
+    // or the driver rejected it, then the program has to be compiled and stored again
+    bool load(GLuint program, const std::string& key);
+    // program has to be linked, with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set before linking
+    void store(GLuint program, const std::string& key);
+
+    ProgramCacheStats stats() const;
+
+private:
+    struct Header {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t keyHash;
+        std::uint64_t driverHash;
+        GLenum format;
+        GLsizei size;
+    };
+
+    static std::uint64_t hash(const std::string& string);
+
+    std::string path(std::uint64_t keyHash) const;
+    // vendor, renderer and version of the driver, queried on first use
+    std::uint64_t driverHash();
+
+private:
+    std::string mDirectory{};
+    std::uint64_t mDriverHash = 0;
+    // -1 until the number of binary formats has been queried
+    GLint mFormatCount = -1;
+    ProgramCacheStats mStats{};
+};
+
+} // namespace vgl
@@ -1,158 +1,402 @@
 #include <vgl/renderer.h>
+#include <vgl/jobs.h>
+#include <vgl/vecmath.h>
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <set>
+#include <unordered_map>
 #include "renderer.h"
 
-const std::string vsNone = R"vs_none(
-#version 460 core
-layout (location = 0) in vec3 aPos;
+// frame constant data, has to match vgl::internal::FrameUniforms
+const std::string glslFrameData = R"frame_data(
+struct Light {
+    vec3 position;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+layout (std140, row_major, binding = 0) uniform FrameData {
+    mat4 uView;
+    mat4 uProjection;
+    vec3 uViewPos;
+    Light uLight;
+};
+
+struct Material {
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+};
+)frame_data";
+
+// model matrix and material either per draw (uniforms), per instance (attributes, see vgl::internal::InstanceData)
+// or per indirect draw (storage buffer, see vgl::internal::DrawData)
+const std::string glslVertexInput = R"vertex_input(
+#ifdef VGL_INSTANCED
+layout (location = 2) in vec4 aModelRow0;
+layout (location = 3) in vec4 aModelRow1;
+layout (location = 4) in vec4 aModelRow2;
+layout (location = 5) in vec3 aMaterialAmbient;
+layout (location = 6) in vec3 aMaterialDiffuse;
+layout (location = 7) in vec4 aMaterialSpecularShininess;
+
+flat out Material InstanceMaterial;
+
+mat4 modelMatrix()
+{
+    return transpose(mat4(aModelRow0, aModelRow1, aModelRow2, vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+void passMaterial()
+{
+    InstanceMaterial = Material(aMaterialAmbient, aMaterialDiffuse, aMaterialSpecularShininess.xyz, aMaterialSpecularShininess.w);
+}
+#elif defined(VGL_INDIRECT)
+struct DrawData {
+    mat4 model;
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specularShininess;
+};
+
+layout (std430, row_major, binding = 1) readonly buffer DrawDataBuffer {
+    DrawData uDraws[];
+};
 
+flat out Material InstanceMaterial;
+
+mat4 modelMatrix()
+{
+    return uDraws[gl_DrawID].model;
+}
+
+void passMaterial()
+{
+    DrawData draw = uDraws[gl_DrawID];
+    InstanceMaterial = Material(draw.ambient.xyz, draw.diffuse.xyz, draw.specularShininess.xyz, draw.specularShininess.w);
+}
+#else
 uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProjection;
 
-void main()
+mat4 modelMatrix()
 {
-    gl_Position = uProjection * uView * uModel * vec4(aPos.x, aPos.y, aPos.z, 1.0);
+    return uModel;
 }
-)vs_none";
 
-const std::string fsNone = R"fs_none(
-#version 460 core
-out vec4 FragColor;
-void main()
+void passMaterial()
 {
-    FragColor = vec4(1.0f, 0.0f, 1.0f, 1.0f);
 }
-)fs_none";
+#endif
+)vertex_input";
+
+const std::string glslFragmentInput = R"fragment_input(
+#if defined(VGL_INSTANCED) || defined(VGL_INDIRECT)
+flat in Material InstanceMaterial;
+#define uMaterial InstanceMaterial
+#else
+uniform Material uMaterial;
+#endif
+)fragment_input";
 
-const std::string vsPhong = R"vs_phong(
-#version 460 core
+// assembled per ProgramFeatures, see vgl::internal::programSources()
+const std::string glslVertexShader = R"vertex_shader(
 layout (location = 0) in vec3 aPos;
+#ifdef VGL_NORMALS
 layout (location = 1) in vec3 aNormal;
 
 out vec3 FragPos;
 out vec3 Normal;
-
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProjection;
+#endif
 
 void main()
 {
-    FragPos = vec3(uModel * vec4(aPos, 1.0));
-    Normal = normalize(vec3(uModel * vec4(aNormal, 1.0)));
-    gl_Position = uProjection * uView * uModel * vec4(aPos.x, aPos.y, aPos.z, 1.0);
+    mat4 model = modelMatrix();
+    passMaterial();
+
+    vec4 worldPos = model * vec4(aPos, 1.0);
+#ifdef VGL_NORMALS
+    FragPos = vec3(worldPos);
+    Normal = normalize(mat3(model) * aNormal);
+#endif
+    gl_Position = uProjection * uView * worldPos;
 }
-)vs_phong";
+)vertex_shader";
 
-const std::string fsPhong = R"fs_phong(
-#version 460 core
+const std::string glslFragmentShader = R"fragment_shader(
 out vec4 FragColor;
 
+#ifdef VGL_NORMALS
 in vec3 FragPos;
 in vec3 Normal;
-
-struct Material {
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;    
-    float shininess;
-};
-
-struct Light {
-    vec3 position;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-uniform vec3 uViewPos;
-uniform Material uMaterial;
-uniform Light uLight;
+#endif
 
 void main()
 {
+#ifdef VGL_NORMALS
     vec3 ambient = uLight.ambient * uMaterial.ambient;
 
     vec3 n = Normal;
     vec3 l = normalize(uLight.position - FragPos);
     vec3 diffuse = uLight.diffuse * uMaterial.diffuse * max(0.0f, dot(n, l));
+    vec3 color = ambient + diffuse;
 
+#if defined(VGL_SPECULAR_PHONG)
     vec3 v = normalize(uViewPos - FragPos);
     vec3 r = reflect(-l, n);
-    vec3 specular = uLight.specular * uMaterial.specular * pow(max(0.0f, dot(r, v)), uMaterial.shininess);
+    color += uLight.specular * uMaterial.specular * pow(max(0.0f, dot(r, v)), uMaterial.shininess);
+#elif defined(VGL_SPECULAR_BLINN_PHONG)
+    vec3 v = normalize(uViewPos - FragPos);
+    vec3 h = normalize(l + v);
+    color += uLight.specular * uMaterial.specular * pow(max(0.0f, dot(h, n)), uMaterial.shininess);
+#endif
 
-    FragColor = vec4(ambient + diffuse + specular, 1.0f);
+    FragColor = vec4(color, 1.0f);
+#else
+    // unlit
+    FragColor = vec4(uMaterial.diffuse, 1.0f);
+#endif
 }
-)fs_phong";
+)fragment_shader";
 
-const std::string fsBlinnPhong = R"fs_blinn_phong(
-#version 460 core
-out vec4 FragColor;
 
-in vec3 FragPos;
-in vec3 Normal;
 
-struct Material {
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;    
-    float shininess;
-};
+namespace vgl::internal {
+    ProgramCache _programCache;
+    std::map<ProgramFeatures, Program> _programMap;
 
-struct Light {
-    vec3 position;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
+    // a coarser level is only taken once its error is this much below the threshold, a finer one once
+    // the current error is this much above it, so that meshes near the threshold do not pop back and forth
+    constexpr GLfloat _lodHysteresis = 0.25f;
 
-uniform vec3 uViewPos;
-uniform Material uMaterial;
-uniform Light uLight;
+    // meshes per job when per mesh work is spread over the job system
+    constexpr std::size_t _meshGrainSize = 256;
 
-void main()
-{
-    vec3 ambient = uLight.ambient * uMaterial.ambient;
+    Program& program(ProgramFeatures features)
+    {
+        // numbered in the order they are created, the feature combinations fit into the 8 bits of the render queue key
+        return _programMap.try_emplace(features, features, static_cast<std::uint32_t>(_programMap.size())).first->second;
+    }
 
-    vec3 n = Normal;
-    vec3 l = normalize(uLight.position - FragPos);
-    vec3 diffuse = uLight.diffuse * uMaterial.diffuse * max(0.0f, dot(n, l));
+    Program& program(LightingModel model, ProgramFeatures submission)
+    {
+        return program(lightingFeatures(model) | submission);
+    }
 
-    vec3 v = normalize(uViewPos - FragPos);
-    vec3 h = normalize(l + v);
-    vec3 specular = uLight.specular * uMaterial.specular * pow(max(0.0f, dot(h, n)), uMaterial.shininess);
+    // the program itself once it is linked, until then the unlit one of the same submission,
+    // which is cheap enough to be waited for
+    Program& drawProgram(LightingModel model, ProgramFeatures submission)
+    {
+        Program& requested = program(model, submission);
+        if (requested.ready()) {
+            return requested;
+        }
+        Program& fallback = program(submission);
+        fallback.finish();
+        return fallback;
+    }
 
-    FragColor = vec4(ambient + diffuse + specular, 1.0f);
-}
-)fs_blinn_phong";
+    // -1 until queried with the first program
+    int _parallelShaderCompile = -1;
 
+    bool parallelShaderCompile()
+    {
+        if (_parallelShaderCompile >= 0) {
+            return _parallelShaderCompile == 1;
+        }
+        _parallelShaderCompile = 0;
+        bool khr = false;
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i) {
+            const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+            if (name == nullptr) {
+                continue;
+            }
+            if (std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0) {
+                khr = true;
+                _parallelShaderCompile = 1;
+            } else if (std::strcmp(name, "GL_ARB_parallel_shader_compile") == 0) {
+                _parallelShaderCompile = 1;
+            }
+        }
+        if (_parallelShaderCompile == 1) {
+            // loaded only now, looking up the functions of a missing extension aborts
+            loadParallelShaderCompileFunctions(khr);
+        }
+        if (glMaxShaderCompilerThreadsKHR != nullptr) {
+            // as many compiler threads as the driver sees fit
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        }
+        return _parallelShaderCompile == 1;
+    }
 
+    const std::array<std::pair<ProgramFeature, const char*>, 5> _featureDefines = {{
+        {ProgramFeature::Normals, "VGL_NORMALS"},
+        {ProgramFeature::SpecularPhong, "VGL_SPECULAR_PHONG"},
+        {ProgramFeature::SpecularBlinnPhong, "VGL_SPECULAR_BLINN_PHONG"},
+        {ProgramFeature::Instanced, "VGL_INSTANCED"},
+        {ProgramFeature::Indirect, "VGL_INDIRECT"}}};
 
-namespace vgl::internal {
-    std::map<LightingModel, Program> _programMap;
+    // vertex and fragment shader with the defines of the features right after the #version directive
+    std::pair<std::string, std::string> programSources(ProgramFeatures features)
+    {
+        std::string header = "#version 460 core\n";
+        for (const auto& [feature, define] : _featureDefines) {
+            if (features.has(feature)) {
+                header += std::string("#define ") + define + "\n";
+            }
+        }
+        return {header + glslFrameData + glslVertexInput + glslVertexShader,
+                header + glslFrameData + glslFragmentInput + glslFragmentShader};
+    }
+
+    const std::array<const char*, static_cast<std::size_t>(Uniform::Count)> _uniformNames = {
+        "uModel",
+        "uMaterial.ambient",
+        "uMaterial.diffuse",
+        "uMaterial.specular",
+        "uMaterial.shininess",
+    };
+
+    static_assert(sizeof(FrameUniforms) == 208, "FrameUniforms does not match the std140 layout");
+
+    constexpr GLuint _frameUniformsBinding = 0;
+    constexpr GLuint _drawDataBinding = 1;
+
+    static_assert(sizeof(InstanceData) == 22 * sizeof(GLfloat), "InstanceData has to be tightly packed");
+    static_assert(sizeof(DrawData) == 112, "DrawData does not match the std430 layout");
+    static_assert(sizeof(DrawElementsIndirectCommand) == 5 * sizeof(GLuint), "DrawElementsIndirectCommand has to be tightly packed");
+
+    // geometry and material layout that meshes have to share to be drawn instanced
+    struct InstanceGroupKey {
+        const GpuGeometry* geometry;
+        const MeshData* data;
+
+        bool operator==(const InstanceGroupKey& other) const
+        {
+            if (geometry != other.geometry) {
+                return false;
+            }
+            if (data == other.data) {
+                return true;
+            }
+            if (data->matTriangleCount != other.data->matTriangleCount || data->materials.size() != other.data->materials.size()) {
+                return false;
+            }
+            for (std::size_t i = 0; i < data->materials.size(); ++i) {
+                if (data->materials[i].lightingModel != other.data->materials[i].lightingModel) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    struct InstanceGroupKeyHash {
+        std::size_t operator()(const InstanceGroupKey& key) const
+        {
+            return std::hash<const GpuGeometry*>()(key.geometry);
+        }
+    };
+
+    // unit cube for occlusion queries, normals are unused
+    const std::array<GLfloat, 24> _boxVertices = {
+        0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 1.0f};
+    const std::array<GLfloat, 24> _boxNormals{};
+    const std::array<GLuint, 36> _boxIndices = {
+        0, 2, 1, 0, 3, 2,
+        4, 5, 6, 4, 6, 7,
+        0, 1, 5, 0, 5, 4,
+        3, 7, 6, 3, 6, 2,
+        0, 4, 7, 0, 7, 3,
+        1, 2, 6, 1, 6, 5};
+
+    const MeshData& boxProxyData()
+    {
+        static const MeshData data = [] {
+            MeshData data;
+            data.vertices = _boxVertices.data();
+            data.normals = _boxNormals.data();
+            data.vertexCount = static_cast<GLsizei>(_boxVertices.size());
+            data.indices = _boxIndices.data();
+            data.indexCount = static_cast<GLsizei>(_boxIndices.size());
+            return data;
+        }();
+        return data;
+    }
+
+    // solves model * result = point for an affine row major matrix, false if the matrix is singular
+    bool inverseTransformPoint(const mat4& model, const vec3& point, vec3& result)
+    {
+        auto dot = [](const vec3& a, const vec3& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; };
+        vec3 c0{model[0][0], model[1][0], model[2][0]};
+        vec3 c1{model[0][1], model[1][1], model[2][1]};
+        vec3 c2{model[0][2], model[1][2], model[2][2]};
+        vec3 b{point[0] - model[0][3], point[1] - model[1][3], point[2] - model[2][3]};
+
+        // Cramer's rule
+        GLfloat determinant = dot(c0, cross(c1, c2));
+        if (std::abs(determinant) < 1e-12f) {
+            return false;
+        }
+        result = {dot(b, cross(c1, c2)) / determinant, dot(c0, cross(b, c2)) / determinant, dot(c0, cross(c1, b)) / determinant};
+        return true;
+    }
+
+    // 22 bit FNV-1a hash over the material values, equal materials end up next to each other in the render queue
+    std::uint32_t materialKey(const Material& mat)
+    {
+        std::uint32_t hash = 2166136261u;
+        auto add = [&hash](const void* data, std::size_t size) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (std::size_t i = 0; i < size; ++i) {
+                hash = (hash ^ bytes[i]) * 16777619u;
+            }
+        };
+        add(mat.ambientColor.data(), sizeof(vec3));
+        add(mat.diffuseColor.data(), sizeof(vec3));
+        add(mat.specularColor.data(), sizeof(vec3));
+        add(&mat.shininess, sizeof(GLfloat));
+        // folded to the 22 material bits of the render queue key
+        return (hash >> 22) ^ (hash & 0x3FFFFF);
+    }
 } // namespace vgl::internal
 
 #define PRINT_WARNING(msg, desc) std::cout  << "[WARNING] " << __FILE__ << " (" << __LINE__ << "):  " \
                                             << __func__ << " (" << msg << ")\n         " << desc << std::endl;
 
-#ifdef VGL_ASYNC_RENDERING
-#define LOCK_FOR_ASYNC_RENDERING(mtx) std::lock_guard<std::mutex> lock(mtx);
-#else
-#define LOCK_FOR_ASYNC_RENDERING(mtx)
-#endif
-
 // ===============================================================================================================
 // Shader
 // ===============================================================================================================
 
-vgl::Shader::Shader(GLenum shaderType, const std::string& code)
+vgl::Shader::Shader(GLenum shaderType, const std::string& code, bool waitForCompilation)
 {
     mID = glCreateShader(shaderType);
     const char* cstr = code.c_str();
     glShaderSource(mID, 1, &cstr, nullptr);
     glCompileShader(mID);
+    if (waitForCompilation) {
+        checkCompileStatus();
+    }
+}
+
+vgl::Shader::~Shader()
+{
+    glDeleteShader(mID);
+}
+
+GLuint vgl::Shader::id() const
+{
+    return mID;
+}
+
+void vgl::Shader::checkCompileStatus() const
+{
     int success;
     glGetShaderiv(mID, GL_COMPILE_STATUS, &success);
     if (!success)
@@ -168,48 +412,78 @@ vgl::Shader::Shader(GLenum shaderType, const std::string& code)
     }
 }
 
-vgl::Shader::~Shader()
+// ===============================================================================================================
+// Program
+// ===============================================================================================================
+
+vgl::ProgramFeatures vgl::lightingFeatures(LightingModel model)
 {
-    glDeleteShader(mID);
+    switch (model)
+    {
+    case LightingModel::Phong:
+        return ProgramFeature::Normals | ProgramFeature::SpecularPhong;
+    case LightingModel::BlinnPhong:
+        return ProgramFeature::Normals | ProgramFeature::SpecularBlinnPhong;
+    case LightingModel::CookTorrance:
+        // TODO: implement, diffuse only until then
+        return ProgramFeature::Normals;
+    default:
+        return ProgramFeatures();
+    }
 }
 
-GLuint vgl::Shader::id() const
+vgl::Program::Program(ProgramFeatures features, std::uint32_t sortIndex)
+    : mSortIndex(sortIndex)
 {
-    return mID;
+    mID = glCreateProgram();
+
+    auto [vsSource, fsSource] = internal::programSources(features);
+
+    // the sources contain the defines of the features
+    mCacheKey = vsSource + '\0' + fsSource;
+    if (internal::_programCache.load(mID, mCacheKey)) {
+        resolveUniformLocations();
+        mReady = true;
+        return;
+    }
+
+    // nothing below waits for the compiler, the status is only queried by ready() and finish()
+    bool parallel = internal::parallelShaderCompile();
+    mVertexShader = std::make_unique<Shader>(GL_VERTEX_SHADER, vsSource, !parallel);
+    mFragmentShader = std::make_unique<Shader>(GL_FRAGMENT_SHADER, fsSource, !parallel);
+    glAttachShader(mID, mVertexShader->id());
+    glAttachShader(mID, mFragmentShader->id());
+    if (internal::_programCache.enabled()) {
+        glProgramParameteri(mID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(mID);
+    if (!parallel) {
+        finish();
+    }
 }
 
-// ===============================================================================================================
-// Program
-// ===============================================================================================================
+vgl::Program::~Program()
+{
+    glDeleteProgram(mID);
+}
 
-vgl::Program::Program(LightingModel model)
+bool vgl::Program::ready()
 {
-    mID = glCreateProgram();
+    if (mReady) {
+        return true;
+    }
+    GLint complete = 0;
+    glGetProgramiv(mID, GL_COMPLETION_STATUS_KHR, &complete);
+    if (complete) {
+        finish();
+    }
+    return mReady;
+}
 
-    {
-        std::unique_ptr<Shader> vs = nullptr;
-        std::unique_ptr<Shader> fs = nullptr;
-        switch (model)
-        {
-        case LightingModel::Phong:
-            vs = std::make_unique<Shader>(GL_VERTEX_SHADER, vsPhong);
-            fs = std::make_unique<Shader>(GL_FRAGMENT_SHADER, fsPhong);
-            break;
-        case LightingModel::BlinnPhong:
-            vs = std::make_unique<Shader>(GL_VERTEX_SHADER, vsPhong);
-            fs = std::make_unique<Shader>(GL_FRAGMENT_SHADER, fsBlinnPhong);
-            break;
-        case LightingModel::CookTorrance:
-            // TODO: implement
-            break;
-        default:
-            vs = std::make_unique<Shader>(GL_VERTEX_SHADER, vsNone);
-            fs = std::make_unique<Shader>(GL_FRAGMENT_SHADER, fsNone);
-            break;
-        }
-        glAttachShader(mID, vs->id());
-        glAttachShader(mID, fs->id());
-        glLinkProgram(mID);
+void vgl::Program::finish()
+{
+    if (mReady) {
+        return;
     }
 
     int success;
@@ -220,16 +494,21 @@ vgl::Program::Program(LightingModel model)
         glGetProgramiv(mID, GL_INFO_LOG_LENGTH, &length);
         char* infoLog = new char[length];
         glGetProgramInfoLog(mID, length, nullptr, infoLog);
+        // a compile error explains more than the link error it causes
+        mVertexShader->checkCompileStatus();
+        mFragmentShader->checkCompileStatus();
         std::cout << "[ERROR] " << __FILE__ << " (" << __LINE__ << "):  " << __func__ << " (Linking failed)" << std::endl;
         std::cout << infoLog << std::endl;
         delete[] infoLog;
         std::abort();
     }
-}
 
-vgl::Program::~Program()
-{
-    glDeleteProgram(mID);
+    internal::_programCache.store(mID, mCacheKey);
+    resolveUniformLocations();
+    mVertexShader = nullptr;
+    mFragmentShader = nullptr;
+    mCacheKey.clear();
+    mReady = true;
 }
 
 void vgl::Program::use() const
@@ -242,6 +521,110 @@ GLuint vgl::Program::id() const
     return mID;
 }
 
+std::uint32_t vgl::Program::sortIndex() const
+{
+    return mSortIndex;
+}
+
+GLint vgl::Program::uniformLocation(Uniform uniform) const
+{
+    return mUniformLocations[static_cast<std::size_t>(uniform)];
+}
+
+void vgl::Program::setUniform(Uniform uniform, GLfloat value)
+{
+    if (updateShadowValue(uniform, &value, 1)) {
+        glUniform1f(uniformLocation(uniform), value);
+    }
+}
+
+void vgl::Program::setUniform(Uniform uniform, const vec3 &value)
+{
+    if (updateShadowValue(uniform, value.data(), 3)) {
+        glUniform3fv(uniformLocation(uniform), 1, value.data());
+    }
+}
+
+void vgl::Program::setUniform(Uniform uniform, const mat4 &value)
+{
+    if (updateShadowValue(uniform, &value[0][0], 16)) {
+        glUniformMatrix4fv(uniformLocation(uniform), 1, GL_TRUE, &value[0][0]);
+    }
+}
+
+vgl::UniformStats vgl::Program::uniformStats() const
+{
+    return mUniformStats;
+}
+
+void vgl::Program::resetUniformStats()
+{
+    mUniformStats = UniformStats{};
+}
+
+void vgl::Program::resolveUniformLocations()
+{
+    for (std::size_t i = 0; i < UniformCount; ++i) {
+        mUniformLocations[i] = glGetUniformLocation(mID, internal::_uniformNames[i]);
+    }
+}
+
+bool vgl::Program::updateShadowValue(Uniform uniform, const GLfloat *value, std::size_t size)
+{
+    std::size_t i = static_cast<std::size_t>(uniform);
+    if (mUniformLocations[i] == -1) {
+        return false;
+    }
+
+    std::array<GLfloat, 16>& shadow = mUniformValues[i];
+    if (mUniformValid[i] && std::equal(value, value + size, shadow.begin())) {
+        ++mUniformStats.skippedUploads;
+        return false;
+    }
+
+    std::copy(value, value + size, shadow.begin());
+    mUniformValid[i] = true;
+    ++mUniformStats.uploads;
+    return true;
+}
+
+vgl::UniformStats vgl::uniformStats()
+{
+    UniformStats stats;
+    for (const auto& [key, program] : internal::_programMap) {
+        UniformStats programStats = program.uniformStats();
+        stats.uploads += programStats.uploads;
+        stats.skippedUploads += programStats.skippedUploads;
+    }
+    return stats;
+}
+
+void vgl::resetUniformStats()
+{
+    for (auto& [key, program] : internal::_programMap) {
+        program.resetUniformStats();
+    }
+}
+
+void vgl::setProgramCacheDirectory(const std::string &directory)
+{
+    internal::_programCache.setDirectory(directory);
+}
+
+vgl::ProgramCacheStats vgl::programCacheStats()
+{
+    return internal::_programCache.stats();
+}
+
+std::size_t vgl::pendingProgramCount()
+{
+    std::size_t count = 0;
+    for (auto& [key, program] : internal::_programMap) {
+        count += program.ready() ? 0 : 1;
+    }
+    return count;
+}
+
 // ===============================================================================================================
 // Mesh
 // ===============================================================================================================
@@ -293,46 +676,103 @@ vgl::mat3 vgl::internal::operator*(const mat3 &a, const mat3 &b)
 
 vgl::mat4 vgl::internal::operator*(const mat4 &a, const mat4 &b)
 {
-    mat4 res;
-    for (int i = 0; i < 4; ++i) {
-        res[i][0] = a[i][0] * b[0][0] + a[i][1] * b[1][0] + a[i][2] * b[2][0] + a[i][3] * b[3][0];
-        res[i][1] = a[i][0] * b[0][1] + a[i][1] * b[1][1] + a[i][2] * b[2][1] + a[i][3] * b[3][1];
-        res[i][2] = a[i][0] * b[0][2] + a[i][1] * b[1][2] + a[i][2] * b[2][2] + a[i][3] * b[3][2];
-        res[i][3] = a[i][0] * b[0][3] + a[i][1] * b[1][3] + a[i][2] * b[2][3] + a[i][3] * b[3][3];
-    }
-    return res;
+    return math::toArray(math::toMat4(a) * math::toMat4(b));
 }
 
 vgl::vec3 vgl::internal::cross(const vec3 &a, const vec3 &b)
 {
-    return vec3{
-        a[1] * b[2] - a[2] * b[1],
-        a[2] * b[0] - a[0] * b[2],
-        a[0] * b[1] - a[1] * b[0]};
+    return math::toArray(math::cross(math::toVec3(a), math::toVec3(b)));
 }
 
 vgl::vec3 vgl::internal::normalize(const vec3 &v)
 {
-    GLfloat length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
-    return vec3{v[0] / length, v[1] / length, v[2] / length};
+    return math::toArray(math::normalize(math::toVec3(v)));
 }
 
-void vgl::Mesh::set(SharedMeshData data)
-{  
-    LOCK_FOR_ASYNC_RENDERING(mMutex)
-    if (data != mData) {
-        mData = data;
-        mDirty = true;
-        mDraw = false;
+void vgl::MeshState::merge(MeshState &older)
+{
+    if (!modelChanged && older.modelChanged) {
+        model = older.model;
+        modelChanged = true;
+    }
+    if (!dataChanged && older.dataChanged) {
+        data = std::move(older.data);
+        dataChanged = true;
     }
+    if (!boundsChanged && older.boundsChanged) {
+        bounds = older.bounds;
+        boundsChanged = true;
+    }
+    geometryChanged = geometryChanged || older.geometryChanged;
+    vertices.add(older.vertices);
+    indices.add(older.indices);
+    materials.add(older.materials);
 }
 
-void vgl::Mesh::translate(const vec3 &translation)
+vgl::mat4 vgl::internal::modelMatrix(const vec3 &position, const mat3 &rotation, const vec3 &scale)
 {
-    using internal::operator+;
-
-    mPosition = mPosition + translation;
-    mModelMatrixDirty = true;
+    mat4 translationMatrix = mat4{
+        1.0f, 0.0f, 0.0f, position[0],
+        0.0f, 1.0f, 0.0f, position[1],
+        0.0f, 0.0f, 1.0f, position[2],
+        0.0f, 0.0f, 0.0f, 1.0f};
+    mat4 rotationMatrix = mat4{
+        rotation[0][0], rotation[0][1], rotation[0][2], 0.0f,
+        rotation[1][0], rotation[1][1], rotation[1][2], 0.0f,
+        rotation[2][0], rotation[2][1], rotation[2][2], 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f};
+    mat4 scaleMatrix = mat4{
+        scale[0], 0.0f, 0.0f, 0.0f,
+        0.0f, scale[1], 0.0f, 0.0f,
+        0.0f, 0.0f, scale[2], 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f};
+
+    return translationMatrix * rotationMatrix * scaleMatrix;
+}
+
+vgl::Bounds vgl::internal::meshBounds(const MeshData &data)
+{
+    if (!data.bounds.valid() || data.usage == GeometryUsage::Dynamic) {
+        return computeBounds(data.vertices, data.vertexCount);
+    }
+    return data.bounds;
+}
+
+void vgl::Mesh::set(SharedMeshData data)
+{  
+    bool dynamic = data != nullptr && data->usage == GeometryUsage::Dynamic;
+    if (data != mSource || dynamic) {
+        mSourceBounds = data != nullptr ? internal::meshBounds(*data) : Bounds{};
+        mSourceBoundsChanged = true;
+    }
+    if (data != mSource) {
+        mSource = data;
+        mSourceChanged = true;
+    } else if (dynamic) {
+        mGeometryChanged = true;
+    }
+}
+
+void vgl::Mesh::markVerticesDirty(GLsizei first, GLsizei count)
+{
+    mDirtyVertices.add(first, count);
+}
+
+void vgl::Mesh::markIndicesDirty(GLsizei first, GLsizei count)
+{
+    mDirtyIndices.add(first, count);
+}
+
+void vgl::Mesh::markMaterialsDirty(GLsizei first, GLsizei count)
+{
+    mDirtyMaterials.add(first, count);
+}
+
+void vgl::Mesh::translate(const vec3 &translation)
+{
+    using internal::operator+;
+
+    mTransform.setPosition(mTransform.position() + translation);
 }
 
 void vgl::Mesh::rotate(GLfloat angle, const vec3 &axis)
@@ -349,41 +789,123 @@ void vgl::Mesh::rotate(GLfloat angle, const vec3 &axis)
     GLfloat yy = y * y, yz = y * z, yw = y * w;
     GLfloat zz = z * z, zw = z * w;
 
-    mRotationMatrix = mat3{
+    mTransform.setRotation(mat3{
         1 - 2 * (yy + zz), 2 * (xy - zw), 2 * (xz + yw),
         2 * (xy + zw), 1 - 2 * (xx + zz), 2 * (yz - xw),
-        2 * (xz - yw), 2 * (yz + xw), 1 - 2 * (xx + yy)};
-
-    mModelMatrixDirty = true;
+        2 * (xz - yw), 2 * (yz + xw), 1 - 2 * (xx + yy)});
 }
 
 void vgl::Mesh::scale(GLfloat scale)
 {
     using internal::operator*;
 
-    mScale = scale * mScale;
-    mModelMatrixDirty = true;
+    mTransform.setScale(scale * mTransform.scale());
 }
 
 void vgl::Mesh::scale(const vec3 &scale)
 {
     using internal::operator*;
 
-    mScale = vec3{scale[0] * mScale[0], scale[1] * mScale[1], scale[2] * mScale[2]};
-    mModelMatrixDirty = true;
+    vec3 current = mTransform.scale();
+    mTransform.setScale(vec3{scale[0] * current[0], scale[1] * current[1], scale[2] * current[2]});
+}
+
+void vgl::Mesh::setOccluder(bool occluder)
+{
+    mOccluder = occluder;
+}
+
+bool vgl::Mesh::occluder() const
+{
+    return mOccluder;
 }
 
 void vgl::Mesh::update()
 {
-    LOCK_FOR_ASYNC_RENDERING(mMutex)
-    if (mModelMatrixDirty) {
-        updateModelMatrix();
+    MeshState state = takeState();
+    update(state);
+    updateWorldBounds();
+}
+
+vgl::MeshState vgl::Mesh::takeState()
+{
+    MeshState state;
+    state.modelChanged = mTransform.takeModel(state.model);
+    if (mSourceChanged) {
+        state.data = mSource;
+        state.dataChanged = true;
+        mSourceChanged = false;
+    }
+    // on this thread, which is the one changing the arrays
+    if (!mDirtyVertices.empty() && mSource != nullptr) {
+        mSourceBounds = computeBounds(mSource->vertices, mSource->vertexCount);
+        mSourceBoundsChanged = true;
+    }
+    state.bounds = mSourceBounds;
+    state.boundsChanged = mSourceBoundsChanged;
+    mSourceBoundsChanged = false;
+    state.geometryChanged = mGeometryChanged;
+    mGeometryChanged = false;
+    std::swap(state.vertices, mDirtyVertices);
+    std::swap(state.indices, mDirtyIndices);
+    std::swap(state.materials, mDirtyMaterials);
+    state.occluder = mOccluder;
+    return state;
+}
+
+void vgl::Mesh::update(MeshState &state)
+{
+    bool rangesDirty = !state.vertices.empty() || !state.indices.empty();
+    bool boundsDirty = state.modelChanged || state.boundsChanged;
+    if (state.modelChanged) {
+        mModel = state.model;
+    }
+    if (state.boundsChanged) {
+        mBounds = state.bounds;
+    }
+    if (state.dataChanged) {
+        mData = std::move(state.data);
+        mDirty = true;
+        mDraw = false;
+    }
+    mDrawOccluder = state.occluder;
+
+    if (!mDirty && (state.geometryChanged || rangesDirty) && !mLevelGeometry.empty()) {
+        GpuGeometry& geometry = *mLevelGeometry.front();
+        bool updated = state.geometryChanged ? geometry.update(*mData) : geometry.update(*mData, state.vertices, state.indices);
+        if (!updated) {
+            // the cache would hand the stale geometry out again to the recreate below
+            internal::_geometryCache.replace(*mData, geometry);
+        }
+        mDirty = !updated;
+    }
+    // another mesh sharing the geometry failed to update it
+    if (!mDirty && !mLevelGeometry.empty() && mLevelGeometry.front()->replaced()) {
+        mDirty = true;
+    }
+    if (!mDirty && !state.materials.empty() && mData != nullptr) {
+        for (const DirtyRanges::Range& range : state.materials.coalesce()) {
+            for (std::size_t i = range.first; i < std::min(range.last, mData->materials.size()); ++i) {
+                internal::program(mData->materials[i].lightingModel, ProgramFeatures());
+            }
+        }
     }
     if (mDirty) {
         destroyGLObjects();
         createGLObjects();
         mDirty = false;
     }
+    state = MeshState{};
+    mWorldBoundsDirty = mWorldBoundsDirty || boundsDirty;
+}
+
+void vgl::Mesh::updateWorldBounds()
+{
+    if (mWorldBoundsDirty) {
+        mWorldBounds = mData != nullptr ? transformBounds(mBounds, mModel) : Bounds{};
+        mWorldBoundsDirty = false;
+        mWorldBoundsChanged = true;
+    }
 }
 
 void vgl::Mesh::draw() const
@@ -395,39 +917,36 @@ void vgl::Mesh::draw() const
     if (mData == nullptr) {
         PRINT_WARNING("Mesh data is null", "Mesh will not be rendered.");
     }
-    if (mVAO == 0) {
-        PRINT_WARNING("VAO is not initialized", "Call update() before draw()");
+    if (mGeometry == nullptr) {
+        PRINT_WARNING("Geometry is not initialized", "Call update() before draw()");
     }
     if (mData->vertices == nullptr || mData->vertexCount == 0) {
         PRINT_WARNING("No vertices", "Mesh will not be rendered.");
     }
-    if (mVerticesVBO == 0) {
-        PRINT_WARNING("Vertices VBO is not initialized", "Corrupted data?");
-    }
     if (mData->indices == nullptr || mData->indexCount == 0) {
         PRINT_WARNING("No indices", "Mesh will not be rendered.");
     }
-    if (mEBO == 0) {
-        PRINT_WARNING("EBO is not initialized", "Corrupted data?");
-    }
     #endif
 
     if (!mDraw) {
         return;
     }
 
-    glBindVertexArray(mVAO);
-    GLsizei primitive = 0;
-    for (size_t i = 0; i < mData->materials.size(); ++i) {
-        const Material& material = mData->materials[i];
-        vgl::Program& program = internal::_programMap.at(material.lightingModel);
+    const MeshData& data = levelData();
+    const GeometryPool& pool = mGeometry->pool();
+    GeometryPool::Range range = mGeometry->range();
+    glBindVertexArray(pool.vao());
+    GLuint primitive = range.firstIndex;
+    for (size_t i = 0; i < data.materials.size(); ++i) {
+        const Material& material = data.materials[i];
+        vgl::Program& program = internal::drawProgram(material.lightingModel, ProgramFeatures());
 
         program.use();
-        setUniforms(program.id(), material);
+        setUniforms(program, material);
         
-        GLsizei vertexCount = mData->matTriangleCount[i] * 3;
-        void* offset = reinterpret_cast<void*>(primitive * sizeof(GLuint));
-        glDrawElements(GL_TRIANGLES, vertexCount, GL_UNSIGNED_INT, offset);
+        GLsizei vertexCount = data.matTriangleCount[i] * 3;
+        void* offset = reinterpret_cast<void*>(primitive * pool.indexSize());
+        glDrawElementsBaseVertex(GL_TRIANGLES, vertexCount, pool.indexType(), offset, range.baseVertex);
         primitive += vertexCount;
 
     }
@@ -436,7 +955,10 @@ void vgl::Mesh::draw() const
 
 void vgl::Mesh::setScene(Scene *scene)
 {
+    // a copy may still carry the proxy of another scene
     mScene = scene;
+    mBvhHandle = BoundingVolumeHierarchy::InvalidHandle;
+    mWorldBoundsChanged = true;
 }
 
 void vgl::Mesh::createGLObjects()
@@ -447,118 +969,112 @@ void vgl::Mesh::createGLObjects()
     }
     mDraw = true;
 
-    glGenVertexArrays(1, &mVAO);
-    if (mVAO == 0) {
-        mDraw = false;
-        return;
-    }
-    glGenBuffers(1, &mVerticesVBO);
-    if (mVerticesVBO == 0) {
-        mDraw = false;
-        return;
-    }
-    // TODO: adapt to lighting model
-    glGenBuffers(1, &mNormalsVBO);
-    if (mNormalsVBO == 0) {
-        mDraw = false;
-        return;
-    }
-    glGenBuffers(1, &mEBO);
-    if (mEBO == 0) {
+    if (!mData->vertices || mData->vertexCount == 0 || !mData->normals || !mData->indices || mData->indexCount == 0) {
         mDraw = false;
         return;
     }
 
-    glBindVertexArray(mVAO);
-
-    if (mData->vertices && mData->vertexCount > 0) {
-        glBindBuffer(GL_ARRAY_BUFFER, mVerticesVBO);
-        glBufferData(GL_ARRAY_BUFFER, mData->vertexCount * sizeof(GLfloat), mData->vertices, GL_STATIC_DRAW);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
-        glEnableVertexAttribArray(0);
-    } else {
-        mDraw = false;
-        return;
-    }
-
-    if (mData->normals && mData->vertexCount == mData->vertexCount) {
-        glBindBuffer(GL_ARRAY_BUFFER, mNormalsVBO);
-        glBufferData(GL_ARRAY_BUFFER, mData->vertexCount * sizeof(GLfloat), mData->normals, GL_STATIC_DRAW);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
-        glEnableVertexAttribArray(1);
-    } else {
+    // meshes with the same source arrays share one range of the geometry pool
+    mGeometry = internal::_geometryCache.acquire(*mData);
+    if (!mGeometry->valid()) {
+        mGeometry = nullptr;
         mDraw = false;
         return;
     }
-        
-    if (mData->indices && mData->indexCount > 0) {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mData->indexCount * sizeof(GLuint), mData->indices, GL_STATIC_DRAW);
-    } else {
-        mDraw = false;
-        return;
+    mLevelGeometry = {mGeometry};
+    mLevel = 0;
+    for (const MeshLod& lod : mData->lods) {
+        if (lod.data == nullptr || lod.data->indexCount == 0) {
+            break;
+        }
+        SharedGpuGeometry geometry = internal::_geometryCache.acquire(*lod.data);
+        if (!geometry->valid()) {
+            break;
+        }
+        mLevelGeometry.push_back(geometry);
     }
-    
-    glBindVertexArray(0);
 
     for (const auto& mat : mData->materials) {
-        internal::_programMap.try_emplace(mat.lightingModel, mat.lightingModel);
+        internal::program(mat.lightingModel, ProgramFeatures());
     }
 }
 
 void vgl::Mesh::destroyGLObjects()
 {
-    glDeleteVertexArrays(1, &mVAO);
-    glDeleteBuffers(1, &mVerticesVBO);
-    glDeleteBuffers(1, &mEBO);
-    mVAO = 0;
-    mVerticesVBO = 0;
-    mEBO = 0;
+    mGeometry = nullptr;
+    mLevelGeometry.clear();
+    mLevel = 0;
 }
 
-void vgl::Mesh::setUniforms(GLuint program, const Material& mat) const
+void vgl::Mesh::setUniforms(Program& program, const Material& mat) const
 {
-    LOCK_FOR_ASYNC_RENDERING(mMutex)
-
-    glUniformMatrix4fv(glGetUniformLocation(program, "uModel"), 1, GL_TRUE, &mModel[0][0]);
 
-    glUniform3fv(glGetUniformLocation(program, "uViewPos"), 1, &mScene->camera().position()[0]);
-    glUniformMatrix4fv(glGetUniformLocation(program, "uView"), 1, GL_TRUE, &mScene->camera().viewMatrix()[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(program, "uProjection"), 1, GL_TRUE, &mScene->camera().projectionMatrix()[0][0]);
+    // camera and light uniforms are shared through the FrameData block of the scene
+    program.setUniform(Uniform::Model, drawModelMatrix());
 
-    glUniform3fv(glGetUniformLocation(program, "uLight.position"), 1, &mScene->lightPosition()[0]);
-    glUniform3fv(glGetUniformLocation(program, "uLight.ambient"), 1, &mScene->lightAmbientColor()[0]);
-    glUniform3fv(glGetUniformLocation(program, "uLight.diffuse"), 1, &mScene->lightDiffuseColor()[0]);
-    glUniform3fv(glGetUniformLocation(program, "uLight.specular"), 1, &mScene->lightSpecularColor()[0]);
+    program.setUniform(Uniform::MaterialAmbient, mat.ambientColor);
+    program.setUniform(Uniform::MaterialDiffuse, mat.diffuseColor);
+    program.setUniform(Uniform::MaterialSpecular, mat.specularColor);
+    program.setUniform(Uniform::MaterialShininess, mat.shininess);
+}
 
-    glUniform3fv(glGetUniformLocation(program, "uMaterial.ambient"), 1, &mat.ambientColor[0]);
-    glUniform3fv(glGetUniformLocation(program, "uMaterial.diffuse"), 1, &mat.diffuseColor[0]);
-    glUniform3fv(glGetUniformLocation(program, "uMaterial.specular"), 1, &mat.specularColor[0]);
-    glUniform1f(glGetUniformLocation(program, "uMaterial.shininess"), mat.shininess);
+GLfloat vgl::Mesh::viewDepth(const mat4 &view) const
+{
+    // the camera looks along -z in view space
+    return -(view[2][0] * mModel[0][3] + view[2][1] * mModel[1][3] + view[2][2] * mModel[2][3] + view[2][3]);
 }
 
-void vgl::Mesh::updateModelMatrix()
+vgl::mat4 vgl::Mesh::drawModelMatrix() const
 {
     using internal::operator*;
 
-    mat4 translationMatrix = mat4{
-        1.0f, 0.0f, 0.0f, mPosition[0],
-        0.0f, 1.0f, 0.0f, mPosition[1],
-        0.0f, 0.0f, 1.0f, mPosition[2],
-        0.0f, 0.0f, 0.0f, 1.0f};
-    mat4 rotationMatrix = mat4{
-        mRotationMatrix[0][0], mRotationMatrix[0][1], mRotationMatrix[0][2], 0.0f,
-        mRotationMatrix[1][0], mRotationMatrix[1][1], mRotationMatrix[1][2], 0.0f,
-        mRotationMatrix[2][0], mRotationMatrix[2][1], mRotationMatrix[2][2], 0.0f,
-        0.0f, 0.0f, 0.0f, 1.0f};
-    mat4 scaleMatrix = mat4{
-        mScale[0], 0.0f, 0.0f, 0.0f,
-        0.0f, mScale[1], 0.0f, 0.0f,
-        0.0f, 0.0f, mScale[2], 0.0f,
+    if (!mGeometry->quantized()) {
+        return mModel;
+    }
+
+    const auto& offset = mGeometry->positionOffset();
+    GLfloat scale = mGeometry->positionScale();
+    return mModel * mat4{
+        scale, 0.0f, 0.0f, offset[0],
+        0.0f, scale, 0.0f, offset[1],
+        0.0f, 0.0f, scale, offset[2],
         0.0f, 0.0f, 0.0f, 1.0f};
-    
-    mModel = translationMatrix * rotationMatrix * scaleMatrix;
-    mModelMatrixDirty = false;
+}
+
+const vgl::MeshData &vgl::Mesh::levelData() const
+{
+    return mLevel == 0 ? *mData : *mData->lods[mLevel - 1].data;
+}
+
+void vgl::Mesh::selectLevel(GLfloat errorScale, GLfloat threshold)
+{
+    if (mLevelGeometry.size() < 2) {
+        return;
+    }
+
+    // errors grow with the level, the coarsest level below a bound is the last one
+    auto projectedError = [&](std::size_t level) {
+        return level == 0 ? 0.0f : mData->lods[level - 1].error * errorScale;
+    };
+    auto coarsestBelow = [&](GLfloat bound) {
+        std::size_t level = 0;
+        while (level + 1 < mLevelGeometry.size() && projectedError(level + 1) <= bound) {
+            ++level;
+        }
+        return level;
+    };
+
+    std::size_t level = mLevel;
+    if (projectedError(mLevel) > threshold * (1.0f + internal::_lodHysteresis)) {
+        level = coarsestBelow(threshold);
+    } else {
+        level = std::max(mLevel, coarsestBelow(threshold * (1.0f - internal::_lodHysteresis)));
+    }
+
+    if (level != mLevel) {
+        mLevel = level;
+        mGeometry = mLevelGeometry[level];
+    }
 }
 
 // ===============================================================================================================
@@ -573,32 +1089,27 @@ vgl::Camera::Camera()
 
 vgl::vec3 vgl::Camera::position() const
 {
-    LOCK_FOR_ASYNC_RENDERING(mMutex)
     return mPosition;
 }
 
 vgl::mat4 vgl::Camera::viewMatrix() const
 {
-    LOCK_FOR_ASYNC_RENDERING(mMutex)
     return mViewMatrix;
 }
 
 vgl::mat4 vgl::Camera::projectionMatrix() const
 {
-    LOCK_FOR_ASYNC_RENDERING(mMutex)
     return mProjectionMatrix;
 }
 
 void vgl::Camera::setPosition(const vec3 &position)
 {
-    LOCK_FOR_ASYNC_RENDERING(mMutex)
     mPosition = position;
     updateViewMatrix();
 }
 
 void vgl::Camera::translate(const vec3 &translation)
 {
-    LOCK_FOR_ASYNC_RENDERING(mMutex)
     mPosition[0] += translation[0];
     mPosition[1] += translation[1];
     mPosition[2] += translation[2];
@@ -618,7 +1129,6 @@ void vgl::Camera::setDirection(const vec3 &dir, const vec3 &up)
     // std::cout << r[0] << ", " << r[1] << ", " << r[2] << std::endl;
     // std::cout << u[0] << ", " << u[1] << ", " << u[2] << std::endl;
 
-    LOCK_FOR_ASYNC_RENDERING(mMutex)
     mRotationMatrix = mat3{
         r[0], u[0], d[0],
         r[1], u[1], d[1],
@@ -654,7 +1164,6 @@ void vgl::Camera::rotate(GLfloat angle, const vec3 &axis)
         2 * (xy + zw), 1 - 2 * (xx + zz), 2 * (yz - xw),
         2 * (xz - yw), 2 * (yz + xw), 1 - 2 * (xx + yy)};
 
-    LOCK_FOR_ASYNC_RENDERING(mMutex)
     mRotationMatrix = rotationMatrix * mRotationMatrix;
     updateViewMatrix();
 }
@@ -663,35 +1172,30 @@ void vgl::Camera::rotate(mat3 rotationMatrix)
 {
     using internal::operator*;
 
-    LOCK_FOR_ASYNC_RENDERING(mMutex)
     mRotationMatrix = rotationMatrix * mRotationMatrix;
     updateViewMatrix();
 }
 
 void vgl::Camera::setNearPlane(GLfloat near)
 {
-    LOCK_FOR_ASYNC_RENDERING(mMutex)
     mNear = near;
     updateProjectionMatrix();
 }
 
 void vgl::Camera::setFarPlane(GLfloat far)
 {
-    LOCK_FOR_ASYNC_RENDERING(mMutex)
     mFar = far;
     updateProjectionMatrix();
 }
 
 void vgl::Camera::setFov(GLfloat fov)
 {
-    LOCK_FOR_ASYNC_RENDERING(mMutex)
     mFov = fov;
     updateProjectionMatrix();
 }
 
 void vgl::Camera::setAspectRatio(GLfloat aspectRatio)
 {
-    LOCK_FOR_ASYNC_RENDERING(mMutex)
     mAspectRatio = aspectRatio;
     updateProjectionMatrix();
 }
@@ -734,18 +1238,66 @@ void vgl::Camera::updateProjectionMatrix()
 // Scene
 // ===============================================================================================================
 
+vgl::Scene::~Scene()
+{
+    for (std::size_t i = 0; i < mQueries.size(); ++i) {
+        releaseOcclusionQuery(i);
+    }
+    if (mIndirectBuffer != 0) {
+        glDeleteBuffers(1, &mIndirectBuffer);
+        glDeleteBuffers(1, &mDrawDataSSBO);
+    }
+    if (mInstanceVBO != 0) {
+        glDeleteBuffers(1, &mInstanceVBO);
+    }
+    if (mFrameUBO != 0) {
+        glDeleteBuffers(1, &mFrameUBO);
+    }
+}
+
 vgl::Mesh& vgl::Scene::addMesh(Mesh mesh)
 {
-    mMeshes.push_back(std::move(mesh));
-    mMeshes.back().setScene(this);
-    return mMeshes.back();
+    Mesh& slot = meshSlot(mNextMeshId.fetch_add(1, std::memory_order_relaxed));
+    slot = std::move(mesh);
+    slot.setScene(this);
+    mMeshCount.store(mMeshes.size(), std::memory_order_release);
+    return slot;
 }
 
 vgl::Mesh &vgl::Scene::addMesh(SharedMeshData data)
 {
-    mMeshes.emplace_back(data);
-    mMeshes.back().setScene(this);
-    return mMeshes.back();
+    return addMesh(Mesh(data));
+}
+
+vgl::MeshId vgl::Scene::queueAddMesh(SharedMeshData data)
+{
+    Bounds bounds = data != nullptr ? internal::meshBounds(*data) : Bounds{};
+    // an id lost to a full queue only leaves an empty mesh behind
+    MeshId id = mNextMeshId.fetch_add(1, std::memory_order_relaxed);
+    SceneCommand command{SceneCommand::Type::AddMesh, id, std::move(data), bounds, {}};
+    return mCommands.push(std::move(command)) ? id : InvalidMeshId;
+}
+
+bool vgl::Scene::queueRemoveMesh(MeshId mesh)
+{
+    return mCommands.push(SceneCommand{SceneCommand::Type::RemoveMesh, mesh, nullptr, {}, {}});
+}
+
+bool vgl::Scene::queueSetMesh(MeshId mesh, SharedMeshData data)
+{
+    Bounds bounds = data != nullptr ? internal::meshBounds(*data) : Bounds{};
+    return mCommands.push(SceneCommand{SceneCommand::Type::SetMesh, mesh, std::move(data), bounds, {}});
+}
+
+bool vgl::Scene::queueSetTransform(MeshId mesh, const vec3 &position, const mat3 &rotation, const vec3 &scale)
+{
+    mat4 model = internal::modelMatrix(position, rotation, scale);
+    return mCommands.push(SceneCommand{SceneCommand::Type::SetTransform, mesh, nullptr, {}, model});
+}
+
+void vgl::Scene::reserveMeshes(std::size_t count)
+{
+    mMeshes.reserve(count);
 }
 
 vgl::Camera &vgl::Scene::camera()
@@ -773,18 +1325,771 @@ vgl::vec3 vgl::Scene::lightSpecularColor() const
     return mLightSpecularColor;
 }
 
+void vgl::Scene::publish()
+{
+#ifdef VGL_ASYNC_RENDERING
+    SceneSnapshot& snapshot = mSnapshots.back();
+    snapshot.camera = mCamera;
+    snapshot.lightPosition = mLightPosition;
+    snapshot.lightAmbientColor = mLightAmbientColor;
+    snapshot.lightDiffuseColor = mLightDiffuseColor;
+    snapshot.lightSpecularColor = mLightSpecularColor;
+
+    // a skipped snapshot comes back as the back buffer, its changes are kept since the meshes forgot them
+    std::size_t meshCount = mMeshCount.load(std::memory_order_acquire);
+    snapshot.meshes.resize(meshCount);
+    for (std::size_t i = 0; i < meshCount; ++i) {
+        MeshState state = mMeshes[i].takeState();
+        if (mSnapshotSkipped) {
+            state.merge(snapshot.meshes[i]);
+        }
+        snapshot.meshes[i] = std::move(state);
+    }
+    mSnapshotSkipped = mSnapshots.publish();
+#endif
+}
+
 void vgl::Scene::update()
 {
+    if (mInstanceVBO == 0) {
+        glGenBuffers(1, &mInstanceVBO);
+    }
+    updateMeshes();
+    updateFrameUniforms();
+    updateRenderQueue();
+}
+
+void vgl::Scene::updateMeshes()
+{
+#ifdef VGL_ASYNC_RENDERING
+    if (mSnapshots.acquire()) {
+        std::vector<MeshState>& states = mSnapshots.front().meshes;
+        for (std::size_t i = 0; i < std::min(states.size(), mMeshes.size()); ++i) {
+            mMeshes[i].update(states[i]);
+        }
+    }
+#else
     for (Mesh& mesh : mMeshes) {
-        mesh.update();
+        MeshState state = mesh.takeState();
+        mesh.update(state);
+    }
+#endif
+    applyCommands();
+
+    // the gl objects are updated above on this thread, the bounds of the meshes are independent of each other
+    jobSystem().parallelFor(mMeshes.size(), internal::_meshGrainSize, [this](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            mMeshes[i].updateWorldBounds();
+        }
+    });
+
+    for (std::size_t i = 0; i < mMeshes.size(); ++i) {
+        Mesh& mesh = mMeshes[i];
+        if (!mesh.mWorldBoundsChanged) {
+            continue;
+        }
+        mesh.mWorldBoundsChanged = false;
+
+        // meshes are never removed from a scene, so their index identifies them in the hierarchy
+        bool tracked = mesh.mDraw && mesh.mWorldBounds.valid();
+        if (tracked && mesh.mBvhHandle == BoundingVolumeHierarchy::InvalidHandle) {
+            mesh.mBvhHandle = mBvh.insert(mesh.mWorldBounds, static_cast<std::uint32_t>(i));
+        } else if (tracked) {
+            mBvh.move(mesh.mBvhHandle, mesh.mWorldBounds);
+        } else if (mesh.mBvhHandle != BoundingVolumeHierarchy::InvalidHandle) {
+            mBvh.remove(mesh.mBvhHandle);
+            mesh.mBvhHandle = BoundingVolumeHierarchy::InvalidHandle;
+        }
+    }
+    mBvh.update();
+}
+
+void vgl::Scene::applyCommands()
+{
+    SceneCommand command;
+    while (mCommands.pop(command)) {
+        if (command.type == SceneCommand::Type::AddMesh && command.mesh >= mMeshes.size()) {
+#ifdef VGL_ASYNC_RENDERING
+            // growing past the capacity would move the meshes the updating thread is reading
+            if (command.mesh >= mMeshes.capacity()) {
+                PRINT_WARNING("Mesh exceeds the reserved capacity of the scene", "Mesh will not be rendered.");
+                continue;
+            }
+#endif
+            meshSlot(command.mesh);
+        }
+        if (command.mesh >= mMeshes.size()) {
+            continue;
+        }
+
+        Mesh& mesh = mMeshes[command.mesh];
+        MeshState state;
+        state.occluder = mesh.mDrawOccluder;
+        switch (command.type) {
+        case SceneCommand::Type::RemoveMesh:
+            releaseOcclusionQuery(command.mesh);
+            [[fallthrough]];
+        case SceneCommand::Type::AddMesh:
+        case SceneCommand::Type::SetMesh:
+            state.data = std::move(command.data);
+            state.dataChanged = true;
+            state.bounds = command.bounds;
+            state.boundsChanged = true;
+            break;
+        case SceneCommand::Type::SetTransform:
+            state.model = command.model;
+            state.modelChanged = true;
+            break;
+        }
+        mesh.update(state);
+    }
+    mMeshCount.store(mMeshes.size(), std::memory_order_release);
+}
+
+vgl::Mesh &vgl::Scene::meshSlot(MeshId id)
+{
+    while (mMeshes.size() <= id) {
+        mMeshes.emplace_back();
+        mMeshes.back().setScene(this);
     }
+    return mMeshes[id];
+}
+
+const vgl::Camera &vgl::Scene::drawCamera() const
+{
+#ifdef VGL_ASYNC_RENDERING
+    return mSnapshots.front().camera;
+#else
+    return mCamera;
+#endif
 }
 
 void vgl::Scene::draw() const
 {
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glBindBufferBase(GL_UNIFORM_BUFFER, internal::_frameUniformsBinding, mFrameUBO);
+
+    if (mSubmissionMode == SubmissionMode::MultiDrawIndirect) {
+        drawIndirect();
+        drawOcclusionQueries();
+        internal::geometryPool(GeometryFormat::Dynamic).endFrame();
+        return;
+    }
+
+    // one pool per geometry format, the queue is sorted by program and format so state only changes with the key
+    for (GeometryPool& pool : internal::_geometryPools) {
+        pool.setInstanceBuffer(mInstanceVBO);
+    }
+
+    const Program* currentProgram = nullptr;
+    const GeometryPool* currentPool = nullptr;
+    for (const RenderItem& item : mRenderQueue.items()) {
+        if (item.program != currentProgram) {
+            item.program->use();
+            currentProgram = item.program;
+        }
+        const GeometryPool& pool = item.mesh->mGeometry->pool();
+        if (&pool != currentPool) {
+            glBindVertexArray(pool.vao());
+            currentPool = &pool;
+        }
+
+        GeometryPool::Range range = item.mesh->mGeometry->range();
+        void* offset = reinterpret_cast<void*>((range.firstIndex + item.firstIndex) * pool.indexSize());
+        if (item.instanceCount > 0) {
+            glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, item.indexCount, pool.indexType(), offset,
+                item.instanceCount, range.baseVertex, item.baseInstance);
+        } else if (item.drawCount > 0) {
+            item.mesh->setUniforms(*item.program, item.mesh->levelData().materials[item.materialIndex]);
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, &mMeshletDrawCounts[item.firstDraw], pool.indexType(),
+                &mMeshletDrawOffsets[item.firstDraw], item.drawCount, &mMeshletDrawBaseVertices[item.firstDraw]);
+        } else {
+            item.mesh->setUniforms(*item.program, item.mesh->levelData().materials[item.materialIndex]);
+            glDrawElementsBaseVertex(GL_TRIANGLES, item.indexCount, pool.indexType(), offset, range.baseVertex);
+        }
+    }
+    glBindVertexArray(0);
+    drawOcclusionQueries();
+    internal::geometryPool(GeometryFormat::Dynamic).endFrame();
+}
+
+void vgl::Scene::warmUpPrograms()
+{
+    std::vector<ProgramFeatures> submissions;
+    if (mSubmissionMode == SubmissionMode::MultiDrawIndirect) {
+        submissions = {ProgramFeature::Indirect};
+    } else {
+        submissions = {ProgramFeatures(), ProgramFeature::Instanced};
+    }
+
+    std::set<LightingModel> models;
+    updateMeshes();
     for (const Mesh& mesh : mMeshes) {
-        mesh.draw();
+        if (mesh.mData == nullptr) {
+            continue;
+        }
+        for (const Material& material : mesh.mData->materials) {
+            models.insert(material.lightingModel);
+        }
+    }
+
+    // the fallbacks are needed right away
+    for (ProgramFeatures submission : submissions) {
+        internal::program(submission).finish();
+        for (LightingModel model : models) {
+            internal::program(model, submission);
+        }
+    }
+}
+
+void vgl::Scene::updateFrameUniforms()
+{
+    auto padded = [](const vec3& v) { return std::array<GLfloat, 4>{v[0], v[1], v[2], 0.0f}; };
+
+#ifdef VGL_ASYNC_RENDERING
+    const SceneSnapshot& snapshot = mSnapshots.front();
+    std::array<vec3, 4> lights{
+        snapshot.lightPosition, snapshot.lightAmbientColor, snapshot.lightDiffuseColor, snapshot.lightSpecularColor};
+#else
+    std::array<vec3, 4> lights{mLightPosition, mLightAmbientColor, mLightDiffuseColor, mLightSpecularColor};
+#endif
+
+    internal::FrameUniforms frameUniforms{
+        drawCamera().viewMatrix(),
+        drawCamera().projectionMatrix(),
+        padded(drawCamera().position()),
+        padded(lights[0]),
+        padded(lights[1]),
+        padded(lights[2]),
+        padded(lights[3])};
+
+    if (mFrameUBO == 0) {
+        glGenBuffers(1, &mFrameUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, mFrameUBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(internal::FrameUniforms), &frameUniforms, GL_DYNAMIC_DRAW);
+    } else if (std::memcmp(&frameUniforms, &mFrameUniforms, sizeof(internal::FrameUniforms)) != 0) {
+        glBindBuffer(GL_UNIFORM_BUFFER, mFrameUBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(internal::FrameUniforms), &frameUniforms);
+    } else {
+        return;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    mFrameUniforms = frameUniforms;
+}
+
+void vgl::Scene::updateRenderQueue()
+{
+    using internal::operator*;
+
+    mRenderQueue.clear();
+    mInstanceData.clear();
+    mVisibleMeshes.clear();
+    mMeshletDrawCounts.clear();
+    mMeshletDrawOffsets.clear();
+    mMeshletDrawBaseVertices.clear();
+    mMeshletCount = 0;
+    mVisibleMeshletCount = 0;
+
+    mat4 view = drawCamera().viewMatrix();
+    mat4 projection = drawCamera().projectionMatrix();
+    mFrustum.setViewProjection(projection * view);
+    if (mFrustumCulling) {
+        mBvh.query(mFrustum, mBvhInside, mBvhIntersecting);
+        for (std::uint32_t index : mBvhInside) {
+            mVisibleMeshes.push_back(&mMeshes[index]);
+        }
+
+        // meshes in nodes crossing a plane get the exact sphere and box test in SIMD batches
+        mFrustumCuller.setFrustum(mFrustum);
+        mFrustumCuller.clear();
+        for (std::uint32_t index : mBvhIntersecting) {
+            mFrustumCuller.add(mMeshes[index].mWorldBounds);
+        }
+        for (std::uint32_t index : mFrustumCuller.cull()) {
+            mVisibleMeshes.push_back(&mMeshes[mBvhIntersecting[index]]);
+        }
+    } else {
+        for (Mesh& mesh : mMeshes) {
+            if (mesh.mDraw) {
+                mVisibleMeshes.push_back(&mesh);
+            }
+        }
+    }
+
+    // projected size of the level error at the distance of the closest point of the bounding sphere
+    vec3 cameraPosition = drawCamera().position();
+    auto selectLevels = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            Mesh* mesh = mVisibleMeshes[i];
+            const Bounds& bounds = mesh->mWorldBounds;
+            if (mesh->mData->lods.empty() || !bounds.valid() || !mesh->mBounds.valid()) {
+                continue;
+            }
+            GLfloat dx = bounds.center[0] - cameraPosition[0];
+            GLfloat dy = bounds.center[1] - cameraPosition[1];
+            GLfloat dz = bounds.center[2] - cameraPosition[2];
+            GLfloat distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz) - bounds.radius, 1e-3f);
+            GLfloat scale = mesh->mBounds.radius > 0.0f ? bounds.radius / mesh->mBounds.radius : 1.0f;
+            mesh->selectLevel(scale * projection[1][1] / (2.0f * distance), mLodThreshold);
+        }
+    };
+    jobSystem().parallelFor(mVisibleMeshes.size(), internal::_meshGrainSize, selectLevels);
+
+    mOcclusionTestedCount = 0;
+    mOccludedCount = 0;
+    if (mOcclusionCulling) {
+        cullOccluded(projection * view);
+    }
+    if (mOcclusionQueries) {
+        updateOcclusionQueries();
+    }
+
+    // meshes referencing the same geometry with the same material layout are drawn instanced
+    std::unordered_map<internal::InstanceGroupKey, std::vector<const Mesh*>, internal::InstanceGroupKeyHash> groups;
+    for (const Mesh* mesh : mVisibleMeshes) {
+        groups[internal::InstanceGroupKey{mesh->mGeometry.get(), &mesh->levelData()}].push_back(mesh);
+    }
+
+    for (const auto& [key, meshes] : groups) {
+        const Mesh& first = *meshes.front();
+        bool instanced = mSubmissionMode == SubmissionMode::Direct && meshes.size() >= mInstancingThreshold;
+
+        if (!instanced) {
+            ProgramFeatures submission = mSubmissionMode == SubmissionMode::MultiDrawIndirect ? ProgramFeature::Indirect : ProgramFeatures();
+            for (const Mesh* mesh : meshes) {
+                pushRenderItems(*mesh, mesh->viewDepth(view), submission, 0, 0);
+            }
+            continue;
+        }
+
+        GLfloat depth = first.viewDepth(view);
+        for (const Mesh* mesh : meshes) {
+            depth = std::min(depth, mesh->viewDepth(view));
+        }
+
+        GLuint baseInstance = static_cast<GLuint>(mInstanceData.size());
+        for (std::size_t slot = 0; slot < first.levelData().materials.size(); ++slot) {
+            // per material slot, the colors of the slot may differ between the instances
+            for (const Mesh* mesh : meshes) {
+                const Material& instanceMaterial = mesh->levelData().materials[slot];
+
+                internal::InstanceData instance;
+                mat4 model = mesh->drawModelMatrix();
+                for (std::size_t row = 0; row < 3; ++row) {
+                    instance.modelRows[row] = model[row];
+                }
+                instance.ambientColor = instanceMaterial.ambientColor;
+                instance.diffuseColor = instanceMaterial.diffuseColor;
+                instance.specularColorShininess = {
+                    instanceMaterial.specularColor[0], instanceMaterial.specularColor[1], instanceMaterial.specularColor[2], instanceMaterial.shininess};
+                mInstanceData.push_back(instance);
+            }
+        }
+        pushRenderItems(first, depth, ProgramFeature::Instanced, baseInstance, static_cast<GLsizei>(meshes.size()));
     }
+
+    mRenderQueue.sort();
+
+    if (mSubmissionMode == SubmissionMode::MultiDrawIndirect) {
+        updateIndirectCommands();
+        return;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, mInstanceData.size() * sizeof(internal::InstanceData), mInstanceData.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void vgl::Scene::cullOccluded(const mat4 &viewProjection)
+{
+    // occluders are drawn at their selected level of detail, like they appear on screen
+    mOcclusionBuffer.begin(viewProjection);
+    for (const Mesh* mesh : mVisibleMeshes) {
+        if (mesh->mDrawOccluder) {
+            const MeshData& data = mesh->levelData();
+            mOcclusionBuffer.addOccluder(data.vertices, data.vertexCount, data.indices, data.indexCount, mesh->mModel);
+        }
+    }
+    mOcclusionBuffer.rasterize();
+
+    auto end = std::remove_if(mVisibleMeshes.begin(), mVisibleMeshes.end(), [this](const Mesh* mesh) {
+        if (mesh->mDrawOccluder) {
+            return false;
+        }
+        ++mOcclusionTestedCount;
+        bool occluded = mOcclusionBuffer.occluded(mesh->mWorldBounds);
+        mOccludedCount += occluded ? 1 : 0;
+        return occluded;
+    });
+    mVisibleMeshes.erase(end, mVisibleMeshes.end());
+}
+
+void vgl::Scene::updateOcclusionQueries()
+{
+    ++mFrame;
+    mQueries.resize(mMeshes.size());
+    mQueryTests.clear();
+    mQueryHiddenMeshes.clear();
+    if (mBoxProxy == nullptr) {
+        mBoxProxy = internal::_geometryCache.acquire(internal::boxProxyData());
+    }
+
+    const auto& nearPlane = mFrustum.planes[4];
+    auto end = std::remove_if(mVisibleMeshes.begin(), mVisibleMeshes.end(), [&](const Mesh* mesh) {
+        std::size_t index = static_cast<std::size_t>(mesh - mMeshes.data());
+        internal::OcclusionQuery& query = mQueries[index];
+        if (query.pending) {
+            GLuint available = 0;
+            glGetQueryObjectuiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available != 0) {
+                GLuint passed = 0;
+                glGetQueryObjectuiv(query.query, GL_QUERY_RESULT, &passed);
+                query.visible = passed != 0;
+                query.pending = false;
+            }
+        }
+
+        // the near plane clips the front of a box reaching behind it, which could fail the query of a visible mesh
+        const Bounds& bounds = mesh->mWorldBounds;
+        GLfloat nearest = nearPlane[3];
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+            nearest += nearPlane[axis] * (nearPlane[axis] >= 0.0f ? bounds.min[axis] : bounds.max[axis]);
+        }
+        if (!bounds.valid() || nearest <= 0.0f) {
+            query.visible = true;
+            return false;
+        }
+
+        // visible meshes are tested with staggered phases so the queries spread over the interval
+        bool due = !query.visible || (mFrame + index) % mOcclusionQueryInterval == 0;
+        if (due && !query.pending) {
+            if (query.query == 0) {
+                glGenQueries(1, &query.query);
+            }
+            query.pending = true;
+            mQueryTests.push_back(mesh);
+        }
+        if (!query.visible) {
+            mQueryHiddenMeshes.push_back(mesh);
+            return true;
+        }
+        return false;
+    });
+    mVisibleMeshes.erase(end, mVisibleMeshes.end());
+}
+
+void vgl::Scene::releaseOcclusionQuery(std::size_t index)
+{
+    if (index >= mQueries.size() || mQueries[index].query == 0) {
+        return;
+    }
+    glDeleteQueries(1, &mQueries[index].query);
+    mQueries[index] = internal::OcclusionQuery{};
+}
+
+void vgl::Scene::drawOcclusionQueries() const
+{
+    if (!mOcclusionQueries || (mQueryTests.empty() && mQueryHiddenMeshes.empty())) {
+        return;
+    }
+
+    // the boxes are tested against the depth of the visible meshes without writing anything
+    Program& program = internal::program(ProgramFeatures());
+    program.finish();
+    const GeometryPool& pool = mBoxProxy->pool();
+    GeometryPool::Range range = mBoxProxy->range();
+    void* offset = reinterpret_cast<void*>(range.firstIndex * pool.indexSize());
+    program.use();
+    glBindVertexArray(pool.vao());
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    for (const Mesh* mesh : mQueryTests) {
+        const Bounds& bounds = mesh->mWorldBounds;
+        program.setUniform(Uniform::Model, mat4{
+            bounds.max[0] - bounds.min[0], 0.0f, 0.0f, bounds.min[0],
+            0.0f, bounds.max[1] - bounds.min[1], 0.0f, bounds.min[1],
+            0.0f, 0.0f, bounds.max[2] - bounds.min[2], bounds.min[2],
+            0.0f, 0.0f, 0.0f, 1.0f});
+
+        GLuint query = mQueries[static_cast<std::size_t>(mesh - mMeshes.data())].query;
+        glBeginQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE, query);
+        glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(internal::_boxIndices.size()), pool.indexType(), offset, range.baseVertex);
+        glEndQuery(GL_ANY_SAMPLES_PASSED_CONSERVATIVE);
+    }
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+    glBindVertexArray(0);
+
+    // the GPU skips hidden meshes whose latest query failed, the CPU never waits for the result
+    for (const Mesh* mesh : mQueryHiddenMeshes) {
+        glBeginConditionalRender(mQueries[static_cast<std::size_t>(mesh - mMeshes.data())].query, GL_QUERY_BY_REGION_NO_WAIT);
+        mesh->draw();
+        glEndConditionalRender();
+    }
+}
+
+void vgl::Scene::pushRenderItems(const Mesh &mesh, GLfloat depth, ProgramFeatures submission, GLuint baseInstance, GLsizei instanceCount)
+{
+    const MeshData& data = mesh.levelData();
+
+    // instances differ in their model matrices, so only meshes drawn on their own are culled per meshlet,
+    // in object space where the meshlet bounds and cones are
+    Frustum frustum;
+    vec3 eye;
+    bool meshlets = mMeshletCulling && instanceCount == 0 && !data.meshlets.empty()
+        && internal::inverseTransformPoint(mesh.mModel, drawCamera().position(), eye);
+    if (meshlets) {
+        frustum = mFrustum.transformed(mesh.mModel);
+    }
+
+    GLuint firstIndex = 0;
+    for (std::size_t i = 0; i < data.materials.size(); ++i) {
+        const Material& material = data.materials[i];
+        GLsizei indexCount = data.matTriangleCount[i] * 3;
+
+        RenderItem item;
+        item.mesh = &mesh;
+        item.program = &internal::drawProgram(material.lightingModel, submission);
+        item.key = RenderQueue::makeKey(item.program->sortIndex(), static_cast<std::uint32_t>(mesh.mGeometry->format()),
+            internal::materialKey(material), depth);
+        item.materialIndex = static_cast<std::uint32_t>(i);
+        item.firstIndex = firstIndex;
+        item.indexCount = indexCount;
+        if (instanceCount > 0) {
+            item.baseInstance = baseInstance + static_cast<GLuint>(i) * instanceCount;
+            item.instanceCount = instanceCount;
+        }
+        firstIndex += indexCount;
+
+        if (meshlets) {
+            item.firstDraw = static_cast<std::uint32_t>(mMeshletDrawCounts.size());
+            pushMeshletDraws(mesh, i, frustum, eye);
+            item.drawCount = static_cast<GLsizei>(mMeshletDrawCounts.size() - item.firstDraw);
+            if (item.drawCount == 0) {
+                continue;
+            }
+        }
+        mRenderQueue.push(item);
+    }
+}
+
+void vgl::Scene::pushMeshletDraws(const Mesh &mesh, std::size_t materialIndex, const Frustum &frustum, const vec3 &eye)
+{
+    const std::vector<Meshlet>& meshlets = mesh.levelData().meshlets;
+    const GeometryPool& pool = mesh.mGeometry->pool();
+    GeometryPool::Range range = mesh.mGeometry->range();
+
+    auto first = std::partition_point(meshlets.begin(), meshlets.end(),
+        [materialIndex](const Meshlet& meshlet) { return meshlet.materialIndex < materialIndex; });
+
+    // the meshlets of a material are consecutive in the index buffer, so visible neighbours share one draw
+    bool extend = false;
+    for (auto it = first; it != meshlets.end() && it->materialIndex == materialIndex; ++it) {
+        ++mMeshletCount;
+        if (frustum.intersect(it->bounds.center, it->bounds.radius) == Intersection::Outside || backfacing(it->bounds, it->cone, eye)) {
+            extend = false;
+            continue;
+        }
+        ++mVisibleMeshletCount;
+
+        if (extend) {
+            mMeshletDrawCounts.back() += it->indexCount;
+            continue;
+        }
+        mMeshletDrawCounts.push_back(it->indexCount);
+        mMeshletDrawOffsets.push_back(reinterpret_cast<const void*>((range.firstIndex + it->firstIndex) * pool.indexSize()));
+        mMeshletDrawBaseVertices.push_back(range.baseVertex);
+        extend = true;
+    }
+}
+
+void vgl::Scene::updateIndirectCommands()
+{
+    if (mIndirectBuffer == 0) {
+        glGenBuffers(1, &mIndirectBuffer);
+        glGenBuffers(1, &mDrawDataSSBO);
+
+        GLint alignment = 0;
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        mDrawDataAlignment = static_cast<std::size_t>(std::max(alignment, 1));
+    }
+
+    mIndirectCommands.clear();
+    mDrawData.clear();
+    mIndirectBatches.clear();
+    for (const RenderItem& item : mRenderQueue.items()) {
+        // gl_DrawID restarts for every multi draw, so each batch gets its own aligned range of draw data
+        const GeometryPool* pool = &item.mesh->mGeometry->pool();
+        if (mIndirectBatches.empty() || mIndirectBatches.back().program != item.program || mIndirectBatches.back().pool != pool) {
+            while ((mDrawData.size() * sizeof(internal::DrawData)) % mDrawDataAlignment != 0) {
+                mDrawData.emplace_back();
+            }
+            mIndirectBatches.push_back(internal::IndirectBatch{
+                item.program,
+                pool,
+                static_cast<GLsizei>(mIndirectCommands.size()),
+                0,
+                static_cast<GLintptr>(mDrawData.size() * sizeof(internal::DrawData))});
+        }
+
+        const Material& material = item.mesh->levelData().materials[item.materialIndex];
+        internal::DrawData drawData{
+            item.mesh->drawModelMatrix(),
+            {material.ambientColor[0], material.ambientColor[1], material.ambientColor[2], 0.0f},
+            {material.diffuseColor[0], material.diffuseColor[1], material.diffuseColor[2], 0.0f},
+            {material.specularColor[0], material.specularColor[1], material.specularColor[2], material.shininess}};
+
+        GeometryPool::Range range = item.mesh->mGeometry->range();
+        if (item.drawCount == 0) {
+            mIndirectCommands.push_back(internal::DrawElementsIndirectCommand{
+                static_cast<GLuint>(item.indexCount), 1, range.firstIndex + item.firstIndex, range.baseVertex, 0});
+            mDrawData.push_back(drawData);
+            ++mIndirectBatches.back().commandCount;
+            continue;
+        }
+
+        // one command per visible meshlet range, gl_DrawID indexes the draw data per command
+        for (std::uint32_t draw = item.firstDraw; draw < item.firstDraw + item.drawCount; ++draw) {
+            GLuint firstIndex = static_cast<GLuint>(reinterpret_cast<std::uintptr_t>(mMeshletDrawOffsets[draw]) / pool->indexSize());
+            mIndirectCommands.push_back(internal::DrawElementsIndirectCommand{
+                static_cast<GLuint>(mMeshletDrawCounts[draw]), 1, firstIndex, mMeshletDrawBaseVertices[draw], 0});
+            mDrawData.push_back(drawData);
+            ++mIndirectBatches.back().commandCount;
+        }
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, mIndirectCommands.size() * sizeof(internal::DrawElementsIndirectCommand), mIndirectCommands.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, mDrawDataSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, mDrawData.size() * sizeof(internal::DrawData), mDrawData.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void vgl::Scene::drawIndirect() const
+{
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+    for (const internal::IndirectBatch& batch : mIndirectBatches) {
+        batch.program->use();
+        glBindVertexArray(batch.pool->vao());
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, internal::_drawDataBinding, mDrawDataSSBO,
+            batch.drawDataOffset, batch.commandCount * sizeof(internal::DrawData));
+
+        const void* offset = reinterpret_cast<const void*>(batch.firstCommand * sizeof(internal::DrawElementsIndirectCommand));
+        glMultiDrawElementsIndirect(GL_TRIANGLES, batch.pool->indexType(), offset, batch.commandCount, 0);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void vgl::Scene::setSubmissionMode(SubmissionMode mode)
+{
+    mSubmissionMode = mode;
+}
+
+vgl::SubmissionMode vgl::Scene::submissionMode() const
+{
+    return mSubmissionMode;
+}
+
+void vgl::Scene::setInstancingThreshold(std::size_t threshold)
+{
+    mInstancingThreshold = threshold;
+}
+
+std::size_t vgl::Scene::instancingThreshold() const
+{
+    return mInstancingThreshold;
+}
+
+void vgl::Scene::setFrustumCulling(bool enabled)
+{
+    mFrustumCulling = enabled;
+}
+
+bool vgl::Scene::frustumCulling() const
+{
+    return mFrustumCulling;
+}
+
+std::size_t vgl::Scene::visibleMeshCount() const
+{
+    return mVisibleMeshes.size();
+}
+
+void vgl::Scene::setMeshletCulling(bool enabled)
+{
+    mMeshletCulling = enabled;
+}
+
+bool vgl::Scene::meshletCulling() const
+{
+    return mMeshletCulling;
+}
+
+std::size_t vgl::Scene::meshletCount() const
+{
+    return mMeshletCount;
+}
+
+std::size_t vgl::Scene::visibleMeshletCount() const
+{
+    return mVisibleMeshletCount;
+}
+
+void vgl::Scene::setOcclusionCulling(bool enabled)
+{
+    mOcclusionCulling = enabled;
+}
+
+bool vgl::Scene::occlusionCulling() const
+{
+    return mOcclusionCulling;
+}
+
+vgl::OcclusionBuffer &vgl::Scene::occlusionBuffer()
+{
+    return mOcclusionBuffer;
+}
+
+GLfloat vgl::Scene::occludedFraction() const
+{
+    return mOcclusionTestedCount > 0 ? static_cast<GLfloat>(mOccludedCount) / mOcclusionTestedCount : 0.0f;
+}
+
+void vgl::Scene::setOcclusionQueries(bool enabled)
+{
+    mOcclusionQueries = enabled;
+}
+
+bool vgl::Scene::occlusionQueries() const
+{
+    return mOcclusionQueries;
+}
+
+void vgl::Scene::setOcclusionQueryInterval(std::size_t frames)
+{
+    mOcclusionQueryInterval = std::max<std::size_t>(frames, 1);
+}
+
+std::size_t vgl::Scene::occlusionQueryInterval() const
+{
+    return mOcclusionQueryInterval;
+}
+
+std::size_t vgl::Scene::queryHiddenMeshCount() const
+{
+    return mQueryHiddenMeshes.size();
+}
+
+void vgl::Scene::setLodThreshold(GLfloat threshold)
+{
+    mLodThreshold = threshold;
+}
+
+GLfloat vgl::Scene::lodThreshold() const
+{
+    return mLodThreshold;
 }
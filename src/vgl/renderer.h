@@ -5,8 +5,17 @@
 #include <memory>
 #include <vector>
 #include <array>
-#include <mutex>
+#include <atomic>
 #include <vgl/gl.h>
+#include <vgl/renderqueue.h>
+#include <vgl/geometry.h>
+#include <vgl/culling.h>
+#include <vgl/bvh.h>
+#include <vgl/occlusion.h>
+#include <vgl/programcache.h>
+#include <vgl/triplebuffer.h>
+#include <vgl/commandqueue.h>
+#include <vgl/transform.h>
 
 
 namespace vgl {
@@ -16,15 +25,23 @@ namespace vgl {
 // ===============================================================================================================
 class Shader {
 public:
-    Shader(GLenum shaderType, const std::string& code);
+    // without waitForCompilation the compile status is only checked by checkCompileStatus(),
+    // so the driver may keep compiling in the background
+    Shader(GLenum shaderType, const std::string& code, bool waitForCompilation = true);
     ~Shader();
 
     GLuint id() const;
+    // aborts with the info log if compilation failed
+    void checkCompileStatus() const;
 
 private:
     GLuint mID;
 };
 
+using vec3 = std::array<GLfloat, 3>;
+using mat3 = std::array<std::array<GLfloat, 3>, 3>;
+using mat4 = std::array<std::array<GLfloat, 4>, 4>;
+
 enum class LightingModel {
     None,
     Phong,
@@ -35,24 +52,131 @@ enum class LightingModel {
 // ===============================================================================================================
 // Program
 // ===============================================================================================================
+// per draw uniforms, camera and light data is shared per frame in a uniform block
+enum class Uniform {
+    Model,
+    MaterialAmbient,
+    MaterialDiffuse,
+    MaterialSpecular,
+    MaterialShininess,
+    Count,
+};
+
+struct UniformStats {
+    std::size_t uploads = 0;
+    std::size_t skippedUploads = 0;
+};
+
+// each feature adds a #define to the shader sources, so a program only contains the code of its features.
+// Without Instanced or Indirect the model matrix and material are read from uniforms
+enum class ProgramFeature : std::uint32_t {
+    Normals = 1 << 0,               // diffuse lighting from the vertex normals, unlit without
+    SpecularPhong = 1 << 1,         // requires Normals
+    SpecularBlinnPhong = 1 << 2,    // requires Normals
+    Instanced = 1 << 3,             // per instance vertex attributes
+    Indirect = 1 << 4,              // shader storage buffer indexed by gl_DrawID
+};
+
+// programs are cached per set of features
+class ProgramFeatures {
+public:
+    constexpr ProgramFeatures() = default;
+    constexpr ProgramFeatures(ProgramFeature feature) : mMask(static_cast<std::uint32_t>(feature)) {}
+
+    constexpr bool operator<(ProgramFeatures other) const { return mMask < other.mMask; }
+    constexpr bool operator==(ProgramFeatures other) const { return mMask == other.mMask; }
+
+    constexpr bool has(ProgramFeature feature) const { return (mMask & static_cast<std::uint32_t>(feature)) != 0; }
+    constexpr std::uint32_t mask() const { return mMask; }
+
+    static constexpr ProgramFeatures fromMask(std::uint32_t mask)
+    {
+        ProgramFeatures features;
+        features.mMask = mask;
+        return features;
+    }
+
+private:
+    std::uint32_t mMask = 0;
+};
+
+constexpr ProgramFeatures operator|(ProgramFeatures a, ProgramFeatures b)
+{
+    return ProgramFeatures::fromMask(a.mask() | b.mask());
+}
+
+constexpr ProgramFeatures operator|(ProgramFeature a, ProgramFeature b)
+{
+    return ProgramFeatures(a) | ProgramFeatures(b);
+}
+
+// features of the shading of a lighting model
+ProgramFeatures lightingFeatures(LightingModel model);
+
 class Program {
 public:
-    Program(LightingModel model);
+    // with KHR_parallel_shader_compile compiling and linking continue in the background, the program
+    // must not be used before ready() has returned true or finish() has been called.
+    // sortIndex is the dense index the render queue sorts programs by
+    Program(ProgramFeatures features, std::uint32_t sortIndex = 0);
     Program(const Program&) = delete;
     Program& operator=(const Program&) = delete;
     ~Program();
 
+    // true once linking has finished, never waits for the compiler with KHR_parallel_shader_compile
+    bool ready();
+    // waits for linking to finish
+    void finish();
+
     void use() const;
 
     GLuint id() const;
+    std::uint32_t sortIndex() const;
+
+    // -1 if the uniform is not active in this program
+    GLint uniformLocation(Uniform uniform) const;
+
+    // the program has to be in use, unchanged values are not uploaded again
+    void setUniform(Uniform uniform, GLfloat value);
+    void setUniform(Uniform uniform, const vec3& value);
+    void setUniform(Uniform uniform, const mat4& value);
+
+    UniformStats uniformStats() const;
+    void resetUniformStats();
 
 private:
+    void resolveUniformLocations();
+    bool updateShadowValue(Uniform uniform, const GLfloat* value, std::size_t size);
+
+private:
+    static constexpr std::size_t UniformCount = static_cast<std::size_t>(Uniform::Count);
+
     GLuint mID;
+    std::uint32_t mSortIndex = 0;
+    bool mReady = false;
+
+    // until linking has finished
+    std::unique_ptr<Shader> mVertexShader = nullptr;
+    std::unique_ptr<Shader> mFragmentShader = nullptr;
+    std::string mCacheKey{};
+
+    std::array<GLint, UniformCount> mUniformLocations{};
+    std::array<std::array<GLfloat, 16>, UniformCount> mUniformValues{};
+    std::array<bool, UniformCount> mUniformValid{};
+    UniformStats mUniformStats{};
 };
 
-using vec3 = std::array<GLfloat, 3>;
-using mat3 = std::array<std::array<GLfloat, 3>, 3>;
-using mat4 = std::array<std::array<GLfloat, 4>, 4>;
+// summed over all programs created by meshes
+UniformStats uniformStats();
+void resetUniformStats();
+
+// programs still compiling in the background, see Scene::warmUpPrograms()
+std::size_t pendingProgramCount();
+
+// programs are stored in and loaded from this directory as linked binaries, which skips compiling them on
+// later runs. Empty (the default) disables the cache, has to be set before the first program is created
+void setProgramCacheDirectory(const std::string& directory);
+ProgramCacheStats programCacheStats();
 
 // ===============================================================================================================
 // Mesh
@@ -66,6 +190,26 @@ struct Material {
     LightingModel lightingModel = LightingModel::None;
 };
 
+struct MeshData;
+
+// coarser version of a mesh, error is the geometric deviation from the full detail mesh in object space
+struct MeshLod {
+    std::shared_ptr<MeshData> data;
+    GLfloat error = 0.0f;
+};
+
+// cluster of triangles within one material range, see buildMeshlets()
+struct Meshlet {
+    // range of the mesh data indices
+    GLuint firstIndex = 0;
+    GLsizei indexCount = 0;
+    std::uint32_t materialIndex = 0;
+
+    // object space
+    Bounds bounds{};
+    NormalCone cone{};
+};
+
 struct MeshData {
     const GLfloat* vertices = nullptr;
     const GLfloat* normals = nullptr;
@@ -76,6 +220,22 @@ struct MeshData {
     const GLuint* indices = nullptr;
     GLsizei indexCount = 0;
 
+    // store positions, normals and indices compressed on the GPU, see GeometryFormat
+    bool quantize = false;
+
+    // dynamic geometry is streamed into a persistently mapped ring, passing the same data to Mesh::set() again
+    // after changing the arrays in place rewrites it without reallocating, as long as the counts stay the same
+    GeometryUsage usage = GeometryUsage::Static;
+
+    // object space bounds, meshes compute their own from the vertices if not valid
+    Bounds bounds{};
+
+    // levels of detail with increasing error and the same materials, see generateLods()
+    std::vector<MeshLod> lods{};
+
+    // ordered by material, each material range is covered by its meshlets in index order
+    std::vector<Meshlet> meshlets{};
+
     std::vector<Material> materials{};
     std::vector<GLsizei> matTriangleCount{};
 };
@@ -94,27 +254,123 @@ namespace internal{
 
     vec3 cross(const vec3& a, const vec3& b);
     vec3 normalize(const vec3& v);
+
+    mat4 modelMatrix(const vec3& position, const mat3& rotation, const vec3& scale);
+    // bounds of data, computed from the vertices if missing or dynamic, since those change in place.
+    // Never stored in data, which may be shared by meshes whose arrays change at different times
+    Bounds meshBounds(const MeshData& data);
+
+    // std140 layout of the FrameData uniform block, vec3 members are padded to 16 bytes
+    struct FrameUniforms {
+        mat4 view;
+        mat4 projection;
+        std::array<GLfloat, 4> viewPos;
+        std::array<GLfloat, 4> lightPosition;
+        std::array<GLfloat, 4> lightAmbientColor;
+        std::array<GLfloat, 4> lightDiffuseColor;
+        std::array<GLfloat, 4> lightSpecularColor;
+    };
+
+    // per instance vertex attributes, the last row of the affine model matrix is implicit
+    struct InstanceData {
+        std::array<std::array<GLfloat, 4>, 3> modelRows;
+        vec3 ambientColor;
+        vec3 diffuseColor;
+        std::array<GLfloat, 4> specularColorShininess;
+    };
+
+    // std430 layout of the per draw data read by indirect programs
+    struct DrawData {
+        mat4 model;
+        std::array<GLfloat, 4> ambientColor;
+        std::array<GLfloat, 4> diffuseColor;
+        std::array<GLfloat, 4> specularColorShininess;
+    };
+
+    struct DrawElementsIndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // hardware occlusion query of a mesh, see Scene::setOcclusionQueries()
+    struct OcclusionQuery {
+        GLuint query = 0;
+        // result of the last finished query, meshes start out visible
+        bool visible = true;
+        // issued and not read back yet
+        bool pending = false;
+    };
+
+    // consecutive indirect commands drawn with the same program
+    struct IndirectBatch {
+        Program* program;
+        const GeometryPool* pool;
+        GLsizei firstCommand;
+        GLsizei commandCount;
+        GLintptr drawDataOffset;
+    };
 } // namespace internal
 
 class Scene;
 
+// changes made to a mesh on the updating thread since they were last handed to the rendering thread
+struct MeshState {
+    mat4 model{};
+    bool modelChanged = false;
+
+    // only set if the data has changed
+    SharedMeshData data = nullptr;
+    bool dataChanged = false;
+    // object space bounds of the data, set with the data and whenever vertices changed
+    Bounds bounds{};
+    bool boundsChanged = false;
+    // dynamic data set again
+    bool geometryChanged = false;
+    DirtyRanges vertices{};
+    DirtyRanges indices{};
+    DirtyRanges materials{};
+
+    bool occluder = false;
+
+    // folds in an older state the rendering thread has never seen
+    void merge(MeshState& older);
+};
+
 class Mesh {
 public:
     Mesh();
     Mesh(SharedMeshData data);
     Mesh(const Mesh&) = default;
+    Mesh(Mesh&&) = default;
     Mesh& operator=(const Mesh&) = default;
+    Mesh& operator=(Mesh&&) = default;
 
-    // arbitrary thread
+    // updating thread, with async rendering the changes reach the rendering thread with Scene::publish()
     void set(SharedMeshData data);
 
+    // updating thread, the arrays of the current data have been changed in place and only the marked
+    // vertex and index ranges are uploaded by the next update(). Indices have to stay within their material
+    // ranges, meshlets and levels of detail are not updated. Materials are read every frame, marking them
+    // only creates the programs of changed lighting models and never touches the geometry
+    void markVerticesDirty(GLsizei first, GLsizei count);
+    void markIndicesDirty(GLsizei first, GLsizei count);
+    void markMaterialsDirty(GLsizei first, GLsizei count);
+
     void translate(const vec3& translation);
     void rotate(GLfloat angle, const vec3& axis);
     void scale(GLfloat scale);
     void scale(const vec3& scale);
 
+    // occluders are rasterized into the occlusion buffer of the scene and hide the meshes behind them
+    void setOccluder(bool occluder);
+    bool occluder() const;
 
-    // rendering thread only
+
+    // rendering thread only, applies the changes made since the last update() directly,
+    // which requires the updating thread to be the rendering thread
     void update();
     void draw() const;
 
@@ -122,36 +378,71 @@ private:
     friend class Scene;
     void setScene(Scene* scene);
 
+    // updating thread, hands over and resets the changes
+    MeshState takeState();
+    // rendering thread, leaves the world bounds to updateWorldBounds()
+    void update(MeshState& state);
+    // touches nothing but the mesh itself, so the meshes of a scene are updated in parallel
+    void updateWorldBounds();
+
 private:
     void createGLObjects();
     void destroyGLObjects();
 
-    void setUniforms(GLuint program, const Material& mat) const;
+    void setUniforms(Program& program, const Material& mat) const;
+
+    // view space depth of the mesh origin
+    GLfloat viewDepth(const mat4& view) const;
 
-    void updateModelMatrix();
+    // model matrix including the decoding of quantized positions
+    mat4 drawModelMatrix() const;
+
+    // data of the selected level of detail
+    const MeshData& levelData() const;
+    // errorScale converts object space errors into fractions of the screen height
+    void selectLevel(GLfloat errorScale, GLfloat threshold);
 
 private:
+    // updating thread
+    SharedMeshData mSource = nullptr;
+    bool mSourceChanged = false;
+    bool mGeometryChanged = false;
+    DirtyRanges mDirtyVertices{};
+    DirtyRanges mDirtyIndices{};
+    DirtyRanges mDirtyMaterials{};
+    Bounds mSourceBounds{};
+    bool mSourceBoundsChanged = false;
+
+    // index into the transform arrays, whose model matrices are composed in batches
+    Transform mTransform{};
+
+    bool mOccluder = false;
+
+    // rendering thread
     SharedMeshData mData = nullptr;
     bool mDirty = false;
     bool mDraw = false;
 
-    GLuint mVerticesVBO = 0, mNormalsVBO = 0, mEBO = 0, mVAO = 0;
-
-    vec3 mPosition{0.0f, 0.0f, 0.0f};
-    vec3 mScale{1.0f, 1.0f, 1.0f};
-    mat3 mRotationMatrix = mat3{
-        1.0f, 0.0f, 0.0f,
-        0.0f, 1.0, 0.0f,
-        0.0f, 0.0f, 1.0f};
-
-    mat4 mModel;
-    bool mModelMatrixDirty = true;
+    // geometry of the selected level
+    SharedGpuGeometry mGeometry = nullptr;
+    std::vector<SharedGpuGeometry> mLevelGeometry{};
+    std::size_t mLevel = 0;
+
+    mat4 mModel = mat4{
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f};
+    bool mDrawOccluder = false;
+
+    // object space bounds of the mesh data, and the same transformed by the model matrix
+    Bounds mBounds{};
+    Bounds mWorldBounds{};
+    bool mWorldBoundsDirty = false;
+    bool mWorldBoundsChanged = false;
+    BoundingVolumeHierarchy::Handle mBvhHandle = BoundingVolumeHierarchy::InvalidHandle;
 
     Scene* mScene = nullptr;
-
-    #ifdef VGL_ASYNC_RENDERING
-    mutable std::mutex mMutex;
-    #endif
 };
 
 // ===============================================================================================================
@@ -180,7 +471,6 @@ public:
     void setAspectRatio(GLfloat aspectRatio);
 
 private:
-    // requires a lock on mMutex
     void updateViewMatrix();
     void updateProjectionMatrix();
 
@@ -199,37 +489,175 @@ private:
 
     mat4 mViewMatrix{};
     mat4 mProjectionMatrix{};
+};
+
+// ===============================================================================================================
+// SceneSnapshot
+// ===============================================================================================================
+// what the rendering thread needs from the updating thread for a frame, see Scene::publish()
+struct SceneSnapshot {
+    Camera camera{};
+    vec3 lightPosition{};
+    vec3 lightAmbientColor{};
+    vec3 lightDiffuseColor{};
+    vec3 lightSpecularColor{};
+
+    // indexed like the meshes of the scene
+    std::vector<MeshState> meshes{};
+};
 
-    #ifdef VGL_ASYNC_RENDERING
-    mutable std::mutex mMutex;
-    #endif
+// ===============================================================================================================
+// SceneCommand
+// ===============================================================================================================
+// index of a mesh in its scene, meshes are never removed from the scene so it stays valid
+using MeshId = std::uint32_t;
+constexpr MeshId InvalidMeshId = ~MeshId(0);
+
+// a change made from any thread through the command queue of a scene
+struct SceneCommand {
+    enum class Type : std::uint8_t {
+        AddMesh,
+        RemoveMesh,
+        SetMesh,
+        SetTransform,
+    };
+
+    Type type = Type::AddMesh;
+    MeshId mesh = InvalidMeshId;
+    SharedMeshData data = nullptr;
+    // bounds of data, computed by the producer
+    Bounds bounds{};
+    mat4 model{};
 };
 
 // ===============================================================================================================
 // Scene
 // ===============================================================================================================
+enum class SubmissionMode {
+    // sorted render queue with instancing, one draw call per material range or instance group
+    Direct,
+    // one glMultiDrawElementsIndirect per program and geometry format over the shared geometry pools
+    MultiDrawIndirect,
+};
+
 class Scene {
 public:
     Scene() = default;
     Scene(const Scene&) = delete;
     Scene& operator=(const Scene&) = delete;
+    // rendering thread
+    ~Scene();
 
+    static constexpr std::size_t CommandCapacity = 4096;
+
+    // updating thread, before the rendering thread starts with async rendering
     Mesh& addMesh(Mesh mesh);
     Mesh& addMesh(SharedMeshData data);
 
+    // any thread, never blocks. The commands are applied in order by the next update(), directly to what the
+    // rendering thread draws, so a mesh should either be changed by commands or by its own methods. Return
+    // InvalidMeshId or false if the queue is full, removed meshes stop drawing and release their geometry
+    MeshId queueAddMesh(SharedMeshData data);
+    bool queueRemoveMesh(MeshId mesh);
+    bool queueSetMesh(MeshId mesh, SharedMeshData data);
+    bool queueSetTransform(MeshId mesh, const vec3& position, const mat3& rotation, const vec3& scale);
+
+    // async rendering only, meshes added by commands while the rendering thread runs have to fit into the
+    // reserved capacity, further ones are dropped. Call before the rendering thread starts
+    void reserveMeshes(std::size_t count);
+
     Camera& camera();
 
+    void setSubmissionMode(SubmissionMode mode);
+    SubmissionMode submissionMode() const;
+
+    // minimum number of meshes sharing geometry before they are drawn instanced
+    void setInstancingThreshold(std::size_t threshold);
+    std::size_t instancingThreshold() const;
+
+    // skip meshes whose bounds are outside of the view frustum
+    void setFrustumCulling(bool enabled);
+    bool frustumCulling() const;
+    // number of meshes that passed culling in the last update()
+    std::size_t visibleMeshCount() const;
+
+    // skip the meshlets of meshes drawn without instancing that are outside of the frustum or face away from the camera
+    void setMeshletCulling(bool enabled);
+    bool meshletCulling() const;
+    // meshlets tested and meshlets drawn in the last update()
+    std::size_t meshletCount() const;
+    std::size_t visibleMeshletCount() const;
+
+    // skip meshes whose bounds are hidden behind occluders, see Mesh::setOccluder()
+    void setOcclusionCulling(bool enabled);
+    bool occlusionCulling() const;
+    OcclusionBuffer& occlusionBuffer();
+    // fraction of the meshes that passed frustum culling and were occluded in the last update()
+    GLfloat occludedFraction() const;
+
+    // test the bounding boxes of meshes with GL_ANY_SAMPLES_PASSED_CONSERVATIVE queries after the visible meshes are drawn.
+    // results are read back frames later without waiting, meshes found hidden are tested every frame and drawn with
+    // conditional rendering on their latest query, visible ones are only tested again every interval frames (CHC++)
+    void setOcclusionQueries(bool enabled);
+    bool occlusionQueries() const;
+    void setOcclusionQueryInterval(std::size_t frames);
+    std::size_t occlusionQueryInterval() const;
+    // meshes drawn with conditional rendering in the last frame
+    std::size_t queryHiddenMeshCount() const;
+
+    // largest projected error of a level of detail, in fractions of the screen height
+    void setLodThreshold(GLfloat threshold);
+    GLfloat lodThreshold() const;
+
     vec3 lightPosition() const;
     vec3 lightAmbientColor() const;
     vec3 lightDiffuseColor() const;
     vec3 lightSpecularColor() const;
 
 
+    // async rendering only, updating thread. Hands the camera, the lights and the changes of all meshes over to
+    // the rendering thread without locks, update() picks up the latest snapshot. Later meshes have to be added
+    // with commands
+    void publish();
+
     // rendering thread only
     void update();
     void draw() const;
+
+    // creates the programs of the materials of all meshes for the submission mode. With KHR_parallel_shader_compile
+    // they compile in the background while meshes are drawn unlit, see pendingProgramCount()
+    void warmUpPrograms();
+
+private:
+    // applies the latest changes and the queued commands to the meshes and refits the hierarchy
+    void updateMeshes();
+    void applyCommands();
+    // grows mMeshes with empty meshes up to the slot of id
+    Mesh& meshSlot(MeshId id);
+    // the camera of the latest snapshot with async rendering
+    const Camera& drawCamera() const;
+    void updateFrameUniforms();
+    void updateRenderQueue();
+    void cullOccluded(const mat4& viewProjection);
+    // reads back finished queries and moves meshes found hidden from the visible meshes to the conditional ones
+    void updateOcclusionQueries();
+    void drawOcclusionQueries() const;
+    // deletes the query object of a mesh, a new one is generated if it is tested again
+    void releaseOcclusionQuery(std::size_t index);
+    // submission is Instanced, Indirect or neither
+    void pushRenderItems(const Mesh& mesh, GLfloat depth, ProgramFeatures submission, GLuint baseInstance, GLsizei instanceCount);
+    // appends the index ranges of the visible meshlets of a material to the meshlet draw list
+    void pushMeshletDraws(const Mesh& mesh, std::size_t materialIndex, const Frustum& frustum, const vec3& eye);
+    void updateIndirectCommands();
+    void drawIndirect() const;
+
 public:
     std::vector<Mesh> mMeshes{};
+    // ids are handed out by producers, the meshes are created when the commands are applied
+    std::atomic<MeshId> mNextMeshId = 0;
+    // size of mMeshes as seen by the updating thread, which never reads past it while the rendering thread adds
+    std::atomic<std::size_t> mMeshCount = 0;
+    CommandQueue<SceneCommand> mCommands{CommandCapacity};
 
     Camera mCamera{};
     vec3 mLightPosition{0.5f, 2.0f, 4.0f};
@@ -237,9 +665,62 @@ public:
     vec3 mLightDiffuseColor{0.8f, 0.8f, 0.8f};
     vec3 mLightSpecularColor{1.0f, 1.0f, 1.0f};
 
-    #ifdef VGL_ASYNC_RENDERING
-    mutable std::mutex mMutex;
-    #endif
+    // std140 uniform block with camera and light data, uploaded once per frame
+    GLuint mFrameUBO = 0;
+    internal::FrameUniforms mFrameUniforms{};
+
+    // rebuilt and sorted by update() each frame
+    RenderQueue mRenderQueue{};
+
+    bool mFrustumCulling = true;
+    // values are indices into mMeshes, nodes fully inside the frustum skip the exact per mesh test
+    BoundingVolumeHierarchy mBvh{};
+    std::vector<std::uint32_t> mBvhInside{};
+    std::vector<std::uint32_t> mBvhIntersecting{};
+    FrustumCuller mFrustumCuller{};
+    std::vector<Mesh*> mVisibleMeshes{};
+    Frustum mFrustum{};
+
+    bool mOcclusionCulling = false;
+    OcclusionBuffer mOcclusionBuffer{};
+    std::size_t mOcclusionTestedCount = 0;
+    std::size_t mOccludedCount = 0;
+
+    bool mOcclusionQueries = false;
+    std::size_t mOcclusionQueryInterval = 8;
+    std::uint64_t mFrame = 0;
+    // indexed like mMeshes
+    std::vector<internal::OcclusionQuery> mQueries{};
+    std::vector<const Mesh*> mQueryTests{};
+    std::vector<const Mesh*> mQueryHiddenMeshes{};
+    // unit cube the bounding boxes are drawn with
+    SharedGpuGeometry mBoxProxy = nullptr;
+
+    // compacted list of visible meshlet ranges for glMultiDrawElementsBaseVertex, adjacent meshlets are merged
+    bool mMeshletCulling = true;
+    std::vector<GLsizei> mMeshletDrawCounts{};
+    std::vector<const void*> mMeshletDrawOffsets{};
+    std::vector<GLint> mMeshletDrawBaseVertices{};
+    std::size_t mMeshletCount = 0;
+    std::size_t mVisibleMeshletCount = 0;
+
+    GLfloat mLodThreshold = 0.002f;
+
+    GLuint mInstanceVBO = 0;
+    std::vector<internal::InstanceData> mInstanceData{};
+    std::size_t mInstancingThreshold = 2;
+
+    SubmissionMode mSubmissionMode = SubmissionMode::Direct;
+    GLuint mIndirectBuffer = 0;
+    GLuint mDrawDataSSBO = 0;
+    std::size_t mDrawDataAlignment = 1;
+    std::vector<internal::DrawElementsIndirectCommand> mIndirectCommands{};
+    std::vector<internal::DrawData> mDrawData{};
+    std::vector<internal::IndirectBatch> mIndirectBatches{};
+
+    TripleBuffer<SceneSnapshot> mSnapshots{};
+    // the snapshot in the back buffer was never acquired and its mesh changes are still pending
+    bool mSnapshotSkipped = false;
 };
 
 } // namespace vgl
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include <vgl/renderqueue.h>
+
+#include <array>
+#include <cstring>
+
+
+std::uint64_t vgl::RenderQueue::makeKey(std::uint32_t program, std::uint32_t geometryFormat, std::uint32_t material, GLfloat depth)
+{
+    // the bit pattern of non-negative floats is ordered like the floats themselves
+    std::uint32_t depthBits = 0;
+    if (depth > 0.0f) {
+        std::memcpy(&depthBits, &depth, sizeof(depthBits));
+    }
+
+    return (static_cast<std::uint64_t>(program & 0xFF) << 56)
+        | (static_cast<std::uint64_t>(geometryFormat & 0x3) << 54)
+        | (static_cast<std::uint64_t>(material & 0x3FFFFF) << 32)
+        | static_cast<std::uint64_t>(depthBits);
+}
+
+void vgl::RenderQueue::clear()
+{
+    mItems.clear();
+}
+
+void vgl::RenderQueue::push(const RenderItem &item)
+{
+    mItems.push_back(item);
+}
+
+void vgl::RenderQueue::sort()
+{
+    constexpr std::size_t passes = sizeof(std::uint64_t);
+
+    // histograms of all 8 byte digits in a single sweep
+    std::array<std::array<std::size_t, 256>, passes> histograms{};
+    for (const RenderItem& item : mItems) {
+        for (std::size_t pass = 0; pass < passes; ++pass) {
+            ++histograms[pass][(item.key >> (pass * 8)) & 0xFF];
+        }
+    }
+
+    mScratch.resize(mItems.size());
+    for (std::size_t pass = 0; pass < passes; ++pass) {
+        std::array<std::size_t, 256>& histogram = histograms[pass];
+
+        // all keys share this digit, nothing to reorder
+        if (histogram[(mItems.empty() ? 0 : mItems.front().key >> (pass * 8)) & 0xFF] == mItems.size()) {
+            continue;
+        }
+
+        std::size_t offset = 0;
+        for (std::size_t& count : histogram) {
+            std::size_t c = count;
+            count = offset;
+            offset += c;
+        }
+
+        for (const RenderItem& item : mItems) {
+            mScratch[histogram[(item.key >> (pass * 8)) & 0xFF]++] = item;
+        }
+        mItems.swap(mScratch);
+    }
+}
+
+const std::vector<vgl::RenderItem>& vgl::RenderQueue::items() const
+{
+    return mItems;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <vgl/gl.h>
+
+
+namespace vgl {
+
+class Mesh;
+class Program;
+
+// ===============================================================================================================
+// RenderQueue
+// ===============================================================================================================
+struct RenderItem {
+    // [63..56] program sort index, [55..54] geometry format, [53..32] material, [31..0] view depth (front to back)
+    std::uint64_t key = 0;
+
+    const Mesh* mesh = nullptr;
+    Program* program = nullptr;
+    std::uint32_t materialIndex = 0;
+
+    GLuint firstIndex = 0;
+    GLsizei indexCount = 0;
+
+    // if drawCount > 0 the item draws these ranges of the meshlet draw list of the scene instead
+    std::uint32_t firstDraw = 0;
+    GLsizei drawCount = 0;
+
+    // instanced draw if instanceCount > 0, the instances start at baseInstance in the instance buffer
+    GLuint baseInstance = 0;
+    GLsizei instanceCount = 0;
+};
+
+class RenderQueue {
+public:
+    static std::uint64_t makeKey(std::uint32_t program, std::uint32_t geometryFormat, std::uint32_t material, GLfloat depth);
+
+    void clear();
+    void push(const RenderItem& item);
+
+    // stable LSD radix sort by key
+    void sort();
+
+    const std::vector<RenderItem>& items() const;
+
+private:
+    std::vector<RenderItem> mItems{};
+    std::vector<RenderItem> mScratch{};
+};
+
+} // namespace vgl
@@ -0,0 +1,269 @@
+#include <vgl/transform.h>
+
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VGL_TRANSFORM_SSE2 1
+#endif
+
+
+namespace vgl::internal {
+    constexpr std::size_t _transformBatchSize = 4;
+}
+
+// ===============================================================================================================
+// TransformStorage
+// ===============================================================================================================
+
+vgl::TransformStorage::Index vgl::TransformStorage::allocate()
+{
+    Index index;
+    if (!mFree.empty()) {
+        index = mFree.back();
+        mFree.pop_back();
+    } else {
+        index = static_cast<Index>(mSize++);
+        if (mSize > mFlags.size()) {
+            std::size_t capacity = mFlags.size() + internal::_transformBatchSize;
+            auto grow = [capacity](std::vector<GLfloat>& component) { component.resize(capacity, 0.0f); };
+            for (auto& component : mPosition) { grow(component); }
+            for (auto& component : mRotation) { grow(component); }
+            for (auto& component : mScale) { grow(component); }
+            for (auto& component : mModel) { grow(component); }
+            mFlags.resize(capacity, 0);
+        }
+    }
+
+    setPosition(index, {0.0f, 0.0f, 0.0f});
+    setRotation(index, {{{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}}});
+    setScale(index, {1.0f, 1.0f, 1.0f});
+    mFlags[index] &= ~Changed;
+    return index;
+}
+
+void vgl::TransformStorage::release(Index index)
+{
+    mFlags[index] &= ~Changed;
+    mFree.push_back(index);
+}
+
+std::array<GLfloat, 3> vgl::TransformStorage::position(Index index) const
+{
+    return {mPosition[0][index], mPosition[1][index], mPosition[2][index]};
+}
+
+std::array<std::array<GLfloat, 3>, 3> vgl::TransformStorage::rotation(Index index) const
+{
+    std::array<std::array<GLfloat, 3>, 3> rotation;
+    for (std::size_t i = 0; i < 9; ++i) {
+        rotation[i / 3][i % 3] = mRotation[i][index];
+    }
+    return rotation;
+}
+
+std::array<GLfloat, 3> vgl::TransformStorage::scale(Index index) const
+{
+    return {mScale[0][index], mScale[1][index], mScale[2][index]};
+}
+
+void vgl::TransformStorage::setPosition(Index index, const std::array<GLfloat, 3> &position)
+{
+    for (std::size_t i = 0; i < 3; ++i) {
+        mPosition[i][index] = position[i];
+    }
+    markDirty(index);
+}
+
+void vgl::TransformStorage::setRotation(Index index, const std::array<std::array<GLfloat, 3>, 3> &rotation)
+{
+    for (std::size_t i = 0; i < 9; ++i) {
+        mRotation[i][index] = rotation[i / 3][i % 3];
+    }
+    markDirty(index);
+}
+
+void vgl::TransformStorage::setScale(Index index, const std::array<GLfloat, 3> &scale)
+{
+    for (std::size_t i = 0; i < 3; ++i) {
+        mScale[i][index] = scale[i];
+    }
+    markDirty(index);
+}
+
+void vgl::TransformStorage::update()
+{
+    for (Index batch : mDirtyBatches) {
+        std::size_t first = batch * internal::_transformBatchSize;
+        composeBatch(first);
+        for (std::size_t index = first; index < first + internal::_transformBatchSize; ++index) {
+            if (mFlags[index] & Dirty) {
+                mFlags[index] = Changed;
+            }
+        }
+    }
+    mDirtyBatches.clear();
+}
+
+bool vgl::TransformStorage::takeChanged(Index index)
+{
+    bool changed = (mFlags[index] & Changed) != 0;
+    mFlags[index] &= ~Changed;
+    return changed;
+}
+
+std::array<std::array<GLfloat, 4>, 4> vgl::TransformStorage::model(Index index) const
+{
+    std::array<std::array<GLfloat, 4>, 4> model{};
+    for (std::size_t i = 0; i < 12; ++i) {
+        model[i / 4][i % 4] = mModel[i][index];
+    }
+    model[3][3] = 1.0f;
+    return model;
+}
+
+void vgl::TransformStorage::markDirty(Index index)
+{
+    if (mFlags[index] & Dirty) {
+        return;
+    }
+    // the whole batch is composed anyway, so it is only listed by its first dirty transform
+    std::size_t first = index - index % internal::_transformBatchSize;
+    bool listed = false;
+    for (std::size_t other = first; other < first + internal::_transformBatchSize; ++other) {
+        listed = listed || (mFlags[other] & Dirty) != 0;
+    }
+    if (!listed) {
+        mDirtyBatches.push_back(static_cast<Index>(index / internal::_transformBatchSize));
+    }
+    mFlags[index] |= Dirty;
+}
+
+void vgl::TransformStorage::composeBatch(std::size_t first)
+{
+    // model = translation * rotation * scale, so the upper 3x3 is the rotation with its columns scaled
+    // and the last column the position
+    #if defined(VGL_TRANSFORM_SSE2)
+    for (std::size_t row = 0; row < 3; ++row) {
+        for (std::size_t column = 0; column < 3; ++column) {
+            __m128 rotation = _mm_loadu_ps(&mRotation[row * 3 + column][first]);
+            __m128 scale = _mm_loadu_ps(&mScale[column][first]);
+            _mm_storeu_ps(&mModel[row * 4 + column][first], _mm_mul_ps(rotation, scale));
+        }
+        _mm_storeu_ps(&mModel[row * 4 + 3][first], _mm_loadu_ps(&mPosition[row][first]));
+    }
+    #else
+    for (std::size_t index = first; index < first + internal::_transformBatchSize; ++index) {
+        for (std::size_t row = 0; row < 3; ++row) {
+            for (std::size_t column = 0; column < 3; ++column) {
+                mModel[row * 4 + column][index] = mRotation[row * 3 + column][index] * mScale[column][index];
+            }
+            mModel[row * 4 + 3][index] = mPosition[row][index];
+        }
+    }
+    #endif
+}
+
+vgl::TransformStorage &vgl::internal::transforms()
+{
+    static TransformStorage storage;
+    return storage;
+}
+
+// ===============================================================================================================
+// Transform
+// ===============================================================================================================
+
+vgl::Transform::Transform(const Transform &other)
+{
+    *this = other;
+}
+
+vgl::Transform::Transform(Transform &&other) noexcept
+    : mIndex(std::exchange(other.mIndex, TransformStorage::InvalidIndex))
+{
+}
+
+vgl::Transform &vgl::Transform::operator=(const Transform &other)
+{
+    if (this == &other || (mIndex == TransformStorage::InvalidIndex && other.mIndex == TransformStorage::InvalidIndex)) {
+        return *this;
+    }
+    setPosition(other.position());
+    setRotation(other.rotation());
+    setScale(other.scale());
+    return *this;
+}
+
+vgl::Transform &vgl::Transform::operator=(Transform &&other) noexcept
+{
+    if (this != &other) {
+        if (mIndex != TransformStorage::InvalidIndex) {
+            internal::transforms().release(mIndex);
+        }
+        mIndex = std::exchange(other.mIndex, TransformStorage::InvalidIndex);
+    }
+    return *this;
+}
+
+vgl::Transform::~Transform()
+{
+    if (mIndex != TransformStorage::InvalidIndex) {
+        internal::transforms().release(mIndex);
+    }
+}
+
+std::array<GLfloat, 3> vgl::Transform::position() const
+{
+    return mIndex != TransformStorage::InvalidIndex ? internal::transforms().position(mIndex) : std::array<GLfloat, 3>{0.0f, 0.0f, 0.0f};
+}
+
+std::array<std::array<GLfloat, 3>, 3> vgl::Transform::rotation() const
+{
+    if (mIndex == TransformStorage::InvalidIndex) {
+        return {{{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}}};
+    }
+    return internal::transforms().rotation(mIndex);
+}
+
+std::array<GLfloat, 3> vgl::Transform::scale() const
+{
+    return mIndex != TransformStorage::InvalidIndex ? internal::transforms().scale(mIndex) : std::array<GLfloat, 3>{1.0f, 1.0f, 1.0f};
+}
+
+void vgl::Transform::setPosition(const std::array<GLfloat, 3> &position)
+{
+    internal::transforms().setPosition(index(), position);
+}
+
+void vgl::Transform::setRotation(const std::array<std::array<GLfloat, 3>, 3> &rotation)
+{
+    internal::transforms().setRotation(index(), rotation);
+}
+
+void vgl::Transform::setScale(const std::array<GLfloat, 3> &scale)
+{
+    internal::transforms().setScale(index(), scale);
+}
+
+bool vgl::Transform::takeModel(std::array<std::array<GLfloat, 4>, 4> &model)
+{
+    if (mIndex == TransformStorage::InvalidIndex) {
+        return false;
+    }
+    TransformStorage& storage = internal::transforms();
+    storage.update();
+    if (!storage.takeChanged(mIndex)) {
+        return false;
+    }
+    model = storage.model(mIndex);
+    return true;
+}
+
+vgl::TransformStorage::Index vgl::Transform::index()
+{
+    if (mIndex == TransformStorage::InvalidIndex) {
+        mIndex = internal::transforms().allocate();
+    }
+    return mIndex;
+}
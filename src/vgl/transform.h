@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <vgl/gl.h>
+
+
+namespace vgl {
+
+// ===============================================================================================================
+// TransformStorage
+// ===============================================================================================================
+// positions, rotations and scales of all transforms in separate arrays, one per component, so composing the
+// model matrices streams through nothing else. Matrices of changed transforms are composed in batches of 4
+// with SSE2, the rows are kept in the same layout until they are read
+class TransformStorage {
+public:
+    using Index = std::uint32_t;
+    static constexpr Index InvalidIndex = std::numeric_limits<Index>::max();
+
+    // identity transform
+    Index allocate();
+    void release(Index index);
+
+    std::array<GLfloat, 3> position(Index index) const;
+    std::array<std::array<GLfloat, 3>, 3> rotation(Index index) const;
+    std::array<GLfloat, 3> scale(Index index) const;
+    void setPosition(Index index, const std::array<GLfloat, 3>& position);
+    void setRotation(Index index, const std::array<std::array<GLfloat, 3>, 3>& rotation);
+    void setScale(Index index, const std::array<GLfloat, 3>& scale);
+
+    // composes the model matrices of all transforms changed since the last call
+    void update();
+    // true once after update() has composed a new model matrix for index
+    bool takeChanged(Index index);
+    // translation * rotation * scale, as of the last update()
+    std::array<std::array<GLfloat, 4>, 4> model(Index index) const;
+
+private:
+    static constexpr std::uint8_t Dirty = 0x1;
+    static constexpr std::uint8_t Changed = 0x2;
+
+    void markDirty(Index index);
+    // composes the 4 transforms starting at first
+    void composeBatch(std::size_t first);
+
+private:
+    // all arrays are padded to a multiple of 4 entries
+    std::array<std::vector<GLfloat>, 3> mPosition{};
+    // row major
+    std::array<std::vector<GLfloat>, 9> mRotation{};
+    std::array<std::vector<GLfloat>, 3> mScale{};
+    // first three rows of the model matrices, the last one is always 0 0 0 1
+    std::array<std::vector<GLfloat>, 12> mModel{};
+
+    std::vector<std::uint8_t> mFlags{};
+    std::size_t mSize = 0;
+    std::vector<Index> mFree{};
+    // batches holding a dirty transform, each listed once
+    std::vector<Index> mDirtyBatches{};
+};
+
+namespace internal {
+    // updating thread only
+    TransformStorage& transforms();
+}
+
+// ===============================================================================================================
+// Transform
+// ===============================================================================================================
+// handle to an entry of the transform storage. The entry is only allocated once the transform is changed,
+// until then it is the identity and costs nothing. Copies get an entry of their own
+class Transform {
+public:
+    Transform() = default;
+    Transform(const Transform& other);
+    Transform(Transform&& other) noexcept;
+    Transform& operator=(const Transform& other);
+    Transform& operator=(Transform&& other) noexcept;
+    ~Transform();
+
+    std::array<GLfloat, 3> position() const;
+    std::array<std::array<GLfloat, 3>, 3> rotation() const;
+    std::array<GLfloat, 3> scale() const;
+    void setPosition(const std::array<GLfloat, 3>& position);
+    void setRotation(const std::array<std::array<GLfloat, 3>, 3>& rotation);
+    void setScale(const std::array<GLfloat, 3>& scale);
+
+    // true if the model matrix has changed since the last call, the changed matrices of all transforms
+    // are composed together by the first call after a change
+    bool takeModel(std::array<std::array<GLfloat, 4>, 4>& model);
+
+private:
+    // allocates the entry on first use
+    TransformStorage::Index index();
+
+private:
+    TransformStorage::Index mIndex = TransformStorage::InvalidIndex;
+};
+
+} // namespace vgl
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+
+namespace vgl {
+
+// ===============================================================================================================
+// TripleBuffer
+// ===============================================================================================================
+// lock free hand over of the latest value from one producer to one consumer. The producer fills back() and
+// publishes it, the consumer acquires the most recently published value into front(). Neither ever waits,
+// values published while the consumer is busy are skipped
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // producer only
+    T& back();
+    // true if the value published before was never acquired, back() then holds that value again
+    bool publish();
+
+    // consumer only, false if nothing has been published since the last acquire()
+    bool acquire();
+    T& front();
+    const T& front() const;
+
+private:
+    static constexpr std::uint8_t IndexMask = 0x3;
+    // set in mMiddle while it holds a value the consumer has not seen
+    static constexpr std::uint8_t FreshBit = 0x4;
+
+    std::array<T, 3> mSlots{};
+    std::uint8_t mFront = 0;
+    std::atomic<std::uint8_t> mMiddle = 1;
+    std::uint8_t mBack = 2;
+};
+
+template <typename T>
+T &TripleBuffer<T>::back()
+{
+    return mSlots[mBack];
+}
+
+template <typename T>
+bool TripleBuffer<T>::publish()
+{
+    std::uint8_t previous = mMiddle.exchange(mBack | FreshBit, std::memory_order_acq_rel);
+    mBack = previous & IndexMask;
+    return (previous & FreshBit) != 0;
+}
+
+template <typename T>
+bool TripleBuffer<T>::acquire()
+{
+    if ((mMiddle.load(std::memory_order_relaxed) & FreshBit) == 0) {
+        return false;
+    }
+    mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & IndexMask;
+    return true;
+}
+
+template <typename T>
+T &TripleBuffer<T>::front()
+{
+    return mSlots[mFront];
+}
+
+template <typename T>
+const T &TripleBuffer<T>::front() const
+{
+    return mSlots[mFront];
+}
+
+} // namespace vgl
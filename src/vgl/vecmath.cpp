@@ -0,0 +1,467 @@
+#include <vgl/vecmath.h>
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VGL_MATH_SSE2 1
+#endif
+
+#if defined(VGL_MATH_SSE2) && defined(__AVX__)
+#include <immintrin.h>
+#define VGL_MATH_AVX 1
+#endif
+
+
+static_assert(sizeof(std::array<std::array<GLfloat, 4>, 4>) == sizeof(vgl::math::Mat4), "matrices have to be bit compatible");
+
+namespace vgl::internal {
+#if defined(VGL_MATH_SSE2)
+    __m128 load(const math::Vec3& v) { return _mm_load_ps(&v.x); }
+    __m128 load(const math::Vec4& v) { return _mm_load_ps(&v.x); }
+
+    math::Vec3 storeVec3(__m128 v)
+    {
+        math::Vec3 result;
+        _mm_store_ps(&result.x, v);
+        result.padding = 0.0f;
+        return result;
+    }
+
+    math::Vec4 storeVec4(__m128 v)
+    {
+        math::Vec4 result;
+        _mm_store_ps(&result.x, v);
+        return result;
+    }
+
+    // x + y + z, added left to right like the scalar code
+    GLfloat sum3(__m128 v)
+    {
+        __m128 y = _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+        __m128 z = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2));
+        return _mm_cvtss_f32(_mm_add_ss(_mm_add_ss(v, y), z));
+    }
+
+    // rows of the transpose of m
+    void columns(const math::Mat4& m, __m128& c0, __m128& c1, __m128& c2, __m128& c3)
+    {
+        c0 = load(m.rows[0]);
+        c1 = load(m.rows[1]);
+        c2 = load(m.rows[2]);
+        c3 = load(m.rows[3]);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    }
+#endif
+} // namespace vgl::internal
+
+vgl::math::Vec3 vgl::math::toVec3(const std::array<GLfloat, 3> &v)
+{
+    return Vec3{v[0], v[1], v[2], 0.0f};
+}
+
+vgl::math::Mat4 vgl::math::toMat4(const std::array<std::array<GLfloat, 4>, 4> &m)
+{
+    Mat4 result;
+    std::memcpy(&result.rows[0].x, m[0].data(), sizeof(Mat4));
+    return result;
+}
+
+std::array<GLfloat, 3> vgl::math::toArray(const Vec3 &v)
+{
+    return {v.x, v.y, v.z};
+}
+
+std::array<std::array<GLfloat, 4>, 4> vgl::math::toArray(const Mat4 &m)
+{
+    std::array<std::array<GLfloat, 4>, 4> result;
+    std::memcpy(result.data(), &m, sizeof(Mat4));
+    return result;
+}
+
+// ===============================================================================================================
+// Vectors
+// ===============================================================================================================
+
+vgl::math::Vec3 vgl::math::operator+(const Vec3 &a, const Vec3 &b)
+{
+    #if defined(VGL_MATH_SSE2)
+    return internal::storeVec3(_mm_add_ps(internal::load(a), internal::load(b)));
+    #else
+    return Vec3{a.x + b.x, a.y + b.y, a.z + b.z, 0.0f};
+    #endif
+}
+
+vgl::math::Vec3 vgl::math::operator-(const Vec3 &a, const Vec3 &b)
+{
+    #if defined(VGL_MATH_SSE2)
+    return internal::storeVec3(_mm_sub_ps(internal::load(a), internal::load(b)));
+    #else
+    return Vec3{a.x - b.x, a.y - b.y, a.z - b.z, 0.0f};
+    #endif
+}
+
+vgl::math::Vec3 vgl::math::operator*(GLfloat a, const Vec3 &b)
+{
+    #if defined(VGL_MATH_SSE2)
+    return internal::storeVec3(_mm_mul_ps(_mm_set1_ps(a), internal::load(b)));
+    #else
+    return Vec3{a * b.x, a * b.y, a * b.z, 0.0f};
+    #endif
+}
+
+vgl::math::Vec4 vgl::math::operator+(const Vec4 &a, const Vec4 &b)
+{
+    #if defined(VGL_MATH_SSE2)
+    return internal::storeVec4(_mm_add_ps(internal::load(a), internal::load(b)));
+    #else
+    return Vec4{a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w};
+    #endif
+}
+
+vgl::math::Vec4 vgl::math::operator-(const Vec4 &a, const Vec4 &b)
+{
+    #if defined(VGL_MATH_SSE2)
+    return internal::storeVec4(_mm_sub_ps(internal::load(a), internal::load(b)));
+    #else
+    return Vec4{a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w};
+    #endif
+}
+
+vgl::math::Vec4 vgl::math::operator*(GLfloat a, const Vec4 &b)
+{
+    #if defined(VGL_MATH_SSE2)
+    return internal::storeVec4(_mm_mul_ps(_mm_set1_ps(a), internal::load(b)));
+    #else
+    return Vec4{a * b.x, a * b.y, a * b.z, a * b.w};
+    #endif
+}
+
+GLfloat vgl::math::dot(const Vec3 &a, const Vec3 &b)
+{
+    #if defined(VGL_MATH_SSE2)
+    return internal::sum3(_mm_mul_ps(internal::load(a), internal::load(b)));
+    #else
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+    #endif
+}
+
+GLfloat vgl::math::dot(const Vec4 &a, const Vec4 &b)
+{
+    #if defined(VGL_MATH_SSE2)
+    __m128 products = _mm_mul_ps(internal::load(a), internal::load(b));
+    __m128 w = _mm_shuffle_ps(products, products, _MM_SHUFFLE(3, 3, 3, 3));
+    return internal::sum3(products) + _mm_cvtss_f32(w);
+    #else
+    return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    #endif
+}
+
+vgl::math::Vec3 vgl::math::cross(const Vec3 &a, const Vec3 &b)
+{
+    #if defined(VGL_MATH_SSE2)
+    __m128 va = internal::load(a);
+    __m128 vb = internal::load(b);
+    __m128 aYZX = _mm_shuffle_ps(va, va, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 bZXY = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(3, 1, 0, 2));
+    __m128 aZXY = _mm_shuffle_ps(va, va, _MM_SHUFFLE(3, 1, 0, 2));
+    __m128 bYZX = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(3, 0, 2, 1));
+    return internal::storeVec3(_mm_sub_ps(_mm_mul_ps(aYZX, bZXY), _mm_mul_ps(aZXY, bYZX)));
+    #else
+    return Vec3{
+        a.y * b.z - a.z * b.y,
+        a.z * b.x - a.x * b.z,
+        a.x * b.y - a.y * b.x,
+        0.0f};
+    #endif
+}
+
+GLfloat vgl::math::length(const Vec3 &v)
+{
+    return std::sqrt(dot(v, v));
+}
+
+vgl::math::Vec3 vgl::math::normalize(const Vec3 &v)
+{
+    GLfloat l = length(v);
+    if (l == 0.0f) {
+        return v;
+    }
+    #if defined(VGL_MATH_SSE2)
+    return internal::storeVec3(_mm_div_ps(internal::load(v), _mm_set1_ps(l)));
+    #else
+    return Vec3{v.x / l, v.y / l, v.z / l, 0.0f};
+    #endif
+}
+
+// ===============================================================================================================
+// Matrices
+// ===============================================================================================================
+
+vgl::math::Mat4 vgl::math::identity()
+{
+    Mat4 result;
+    result.rows[0].x = 1.0f;
+    result.rows[1].y = 1.0f;
+    result.rows[2].z = 1.0f;
+    result.rows[3].w = 1.0f;
+    return result;
+}
+
+vgl::math::Mat4 vgl::math::operator*(const Mat4 &a, const Mat4 &b)
+{
+    Mat4 result;
+    // every row of the result is the rows of b weighted by the elements of the same row of a
+    #if defined(VGL_MATH_AVX)
+    __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&b.rows[0]));
+    __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&b.rows[1]));
+    __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&b.rows[2]));
+    __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&b.rows[3]));
+    for (std::size_t i = 0; i < 4; i += 2) {
+        // two rows at once, one per 128 bit lane
+        __m256 rows = _mm256_loadu_ps(&a.rows[i].x);
+        __m256 r = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(3, 3, 3, 3)), b3));
+        _mm256_storeu_ps(&result.rows[i].x, r);
+    }
+    #elif defined(VGL_MATH_SSE2)
+    __m128 b0 = internal::load(b.rows[0]);
+    __m128 b1 = internal::load(b.rows[1]);
+    __m128 b2 = internal::load(b.rows[2]);
+    __m128 b3 = internal::load(b.rows[3]);
+    for (std::size_t i = 0; i < 4; ++i) {
+        const Vec4& row = a.rows[i];
+        __m128 r = _mm_mul_ps(_mm_set1_ps(row.x), b0);
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(row.y), b1));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(row.z), b2));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(row.w), b3));
+        _mm_store_ps(&result.rows[i].x, r);
+    }
+    #else
+    for (std::size_t i = 0; i < 4; ++i) {
+        const Vec4& row = a.rows[i];
+        result.rows[i] = Vec4{
+            row.x * b.rows[0].x + row.y * b.rows[1].x + row.z * b.rows[2].x + row.w * b.rows[3].x,
+            row.x * b.rows[0].y + row.y * b.rows[1].y + row.z * b.rows[2].y + row.w * b.rows[3].y,
+            row.x * b.rows[0].z + row.y * b.rows[1].z + row.z * b.rows[2].z + row.w * b.rows[3].z,
+            row.x * b.rows[0].w + row.y * b.rows[1].w + row.z * b.rows[2].w + row.w * b.rows[3].w};
+    }
+    #endif
+    return result;
+}
+
+vgl::math::Vec4 vgl::math::operator*(const Mat4 &m, const Vec4 &v)
+{
+    #if defined(VGL_MATH_SSE2)
+    __m128 c0, c1, c2, c3;
+    internal::columns(m, c0, c1, c2, c3);
+    __m128 r = _mm_mul_ps(c0, _mm_set1_ps(v.x));
+    r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(v.y)));
+    r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(v.z)));
+    r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(v.w)));
+    return internal::storeVec4(r);
+    #else
+    return Vec4{dot(m.rows[0], v), dot(m.rows[1], v), dot(m.rows[2], v), dot(m.rows[3], v)};
+    #endif
+}
+
+vgl::math::Mat4 vgl::math::transpose(const Mat4 &m)
+{
+    Mat4 result;
+    #if defined(VGL_MATH_SSE2)
+    __m128 c0, c1, c2, c3;
+    internal::columns(m, c0, c1, c2, c3);
+    _mm_store_ps(&result.rows[0].x, c0);
+    _mm_store_ps(&result.rows[1].x, c1);
+    _mm_store_ps(&result.rows[2].x, c2);
+    _mm_store_ps(&result.rows[3].x, c3);
+    #else
+    const GLfloat* source = &m.rows[0].x;
+    GLfloat* target = &result.rows[0].x;
+    for (std::size_t row = 0; row < 4; ++row) {
+        for (std::size_t column = 0; column < 4; ++column) {
+            target[column * 4 + row] = source[row * 4 + column];
+        }
+    }
+    #endif
+    return result;
+}
+
+bool vgl::math::inverse(const Mat4 &m, Mat4 &result)
+{
+    const Vec4& r0 = m.rows[0];
+    const Vec4& r1 = m.rows[1];
+    const Vec4& r2 = m.rows[2];
+    const Vec4& r3 = m.rows[3];
+
+    // 2x2 determinants of the upper and the lower two rows
+    GLfloat s0 = r0.x * r1.y - r0.y * r1.x;
+    GLfloat s1 = r0.x * r1.z - r0.z * r1.x;
+    GLfloat s2 = r0.x * r1.w - r0.w * r1.x;
+    GLfloat s3 = r0.y * r1.z - r0.z * r1.y;
+    GLfloat s4 = r0.y * r1.w - r0.w * r1.y;
+    GLfloat s5 = r0.z * r1.w - r0.w * r1.z;
+    GLfloat c0 = r2.x * r3.y - r2.y * r3.x;
+    GLfloat c1 = r2.x * r3.z - r2.z * r3.x;
+    GLfloat c2 = r2.x * r3.w - r2.w * r3.x;
+    GLfloat c3 = r2.y * r3.z - r2.z * r3.y;
+    GLfloat c4 = r2.y * r3.w - r2.w * r3.y;
+    GLfloat c5 = r2.z * r3.w - r2.w * r3.z;
+
+    GLfloat determinant = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    if (determinant == 0.0f) {
+        return false;
+    }
+
+    Mat4 adjugate;
+    adjugate.rows[0] = Vec4{
+        r1.y * c5 - r1.z * c4 + r1.w * c3,
+        -r0.y * c5 + r0.z * c4 - r0.w * c3,
+        r3.y * s5 - r3.z * s4 + r3.w * s3,
+        -r2.y * s5 + r2.z * s4 - r2.w * s3};
+    adjugate.rows[1] = Vec4{
+        -r1.x * c5 + r1.z * c2 - r1.w * c1,
+        r0.x * c5 - r0.z * c2 + r0.w * c1,
+        -r3.x * s5 + r3.z * s2 - r3.w * s1,
+        r2.x * s5 - r2.z * s2 + r2.w * s1};
+    adjugate.rows[2] = Vec4{
+        r1.x * c4 - r1.y * c2 + r1.w * c0,
+        -r0.x * c4 + r0.y * c2 - r0.w * c0,
+        r3.x * s4 - r3.y * s2 + r3.w * s0,
+        -r2.x * s4 + r2.y * s2 - r2.w * s0};
+    adjugate.rows[3] = Vec4{
+        -r1.x * c3 + r1.y * c1 - r1.z * c0,
+        r0.x * c3 - r0.y * c1 + r0.z * c0,
+        -r3.x * s3 + r3.y * s1 - r3.z * s0,
+        r2.x * s3 - r2.y * s1 + r2.z * s0};
+
+    GLfloat inverseDeterminant = 1.0f / determinant;
+    for (Vec4& row : adjugate.rows) {
+        row = inverseDeterminant * row;
+    }
+    result = adjugate;
+    return true;
+}
+
+vgl::math::Mat4 vgl::math::normalMatrix(const Mat4 &m)
+{
+    // the cofactor matrix is the inverse transpose scaled by the determinant, its rows are cross products
+    Vec3 r0{m.rows[0].x, m.rows[0].y, m.rows[0].z, 0.0f};
+    Vec3 r1{m.rows[1].x, m.rows[1].y, m.rows[1].z, 0.0f};
+    Vec3 r2{m.rows[2].x, m.rows[2].y, m.rows[2].z, 0.0f};
+    Vec3 n0 = cross(r1, r2);
+    Vec3 n1 = cross(r2, r0);
+    Vec3 n2 = cross(r0, r1);
+
+    Mat4 result;
+    result.rows[0] = Vec4{n0.x, n0.y, n0.z, 0.0f};
+    result.rows[1] = Vec4{n1.x, n1.y, n1.z, 0.0f};
+    result.rows[2] = Vec4{n2.x, n2.y, n2.z, 0.0f};
+    result.rows[3] = Vec4{0.0f, 0.0f, 0.0f, 1.0f};
+    return result;
+}
+
+vgl::math::Vec4 vgl::math::transformPoint(const Mat4 &m, const Vec3 &point)
+{
+    Vec4 result;
+    transformPoints(m, &point.x, 1, &result.x);
+    return result;
+}
+
+void vgl::math::transformPoints(const Mat4 &m, const GLfloat *points, std::size_t count, GLfloat *result)
+{
+    // columns weighted by the coordinates, the translation is added last like in the scalar code
+    std::size_t i = 0;
+    #if defined(VGL_MATH_SSE2)
+    __m128 c0, c1, c2, c3;
+    internal::columns(m, c0, c1, c2, c3);
+    #if defined(VGL_MATH_AVX)
+    // two points at once, one per 128 bit lane
+    __m256 wc0 = _mm256_insertf128_ps(_mm256_castps128_ps256(c0), c0, 1);
+    __m256 wc1 = _mm256_insertf128_ps(_mm256_castps128_ps256(c1), c1, 1);
+    __m256 wc2 = _mm256_insertf128_ps(_mm256_castps128_ps256(c2), c2, 1);
+    __m256 wc3 = _mm256_insertf128_ps(_mm256_castps128_ps256(c3), c3, 1);
+    auto pair = [](GLfloat a, GLfloat b) {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(a)), _mm_set1_ps(b), 1);
+    };
+    for (; i + 2 <= count; i += 2) {
+        const GLfloat* p = points + 3 * i;
+        __m256 r = _mm256_mul_ps(wc0, pair(p[0], p[3]));
+        r = _mm256_add_ps(r, _mm256_mul_ps(wc1, pair(p[1], p[4])));
+        r = _mm256_add_ps(r, _mm256_mul_ps(wc2, pair(p[2], p[5])));
+        r = _mm256_add_ps(r, wc3);
+        _mm256_storeu_ps(result + 4 * i, r);
+    }
+    #endif
+    for (; i < count; ++i) {
+        const GLfloat* p = points + 3 * i;
+        __m128 r = _mm_mul_ps(c0, _mm_set1_ps(p[0]));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(p[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(p[2])));
+        r = _mm_add_ps(r, c3);
+        _mm_storeu_ps(result + 4 * i, r);
+    }
+    #else
+    for (; i < count; ++i) {
+        const GLfloat* p = points + 3 * i;
+        for (std::size_t row = 0; row < 4; ++row) {
+            const Vec4& r = m.rows[row];
+            result[4 * i + row] = r.x * p[0] + r.y * p[1] + r.z * p[2] + r.w;
+        }
+    }
+    #endif
+}
+
+// ===============================================================================================================
+// Quaternions
+// ===============================================================================================================
+
+vgl::math::Quat vgl::math::fromAxisAngle(const Vec3 &axis, GLfloat angle)
+{
+    GLfloat sinHalfAngle = std::sin(angle / 2);
+    return Quat{axis.x * sinHalfAngle, axis.y * sinHalfAngle, axis.z * sinHalfAngle, std::cos(angle / 2)};
+}
+
+vgl::math::Quat vgl::math::operator*(const Quat &a, const Quat &b)
+{
+    return Quat{
+        a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+        a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+        a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+        a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z};
+}
+
+vgl::math::Quat vgl::math::normalize(const Quat &q)
+{
+    GLfloat l = dot(Vec4{q.x, q.y, q.z, q.w}, Vec4{q.x, q.y, q.z, q.w});
+    if (l == 0.0f) {
+        return Quat{};
+    }
+    l = std::sqrt(l);
+    return Quat{q.x / l, q.y / l, q.z / l, q.w / l};
+}
+
+vgl::math::Vec3 vgl::math::rotate(const Quat &q, const Vec3 &v)
+{
+    // v + 2 w (u x v) + 2 u x (u x v) with u the vector part
+    Vec3 u{q.x, q.y, q.z, 0.0f};
+    Vec3 t = 2.0f * cross(u, v);
+    return v + q.w * t + cross(u, t);
+}
+
+vgl::math::Mat4 vgl::math::toMat4(const Quat &q)
+{
+    GLfloat xx = q.x * q.x, xy = q.x * q.y, xz = q.x * q.z, xw = q.x * q.w;
+    GLfloat yy = q.y * q.y, yz = q.y * q.z, yw = q.y * q.w;
+    GLfloat zz = q.z * q.z, zw = q.z * q.w;
+
+    Mat4 result;
+    result.rows[0] = Vec4{1 - 2 * (yy + zz), 2 * (xy - zw), 2 * (xz + yw), 0.0f};
+    result.rows[1] = Vec4{2 * (xy + zw), 1 - 2 * (xx + zz), 2 * (yz - xw), 0.0f};
+    result.rows[2] = Vec4{2 * (xz - yw), 2 * (yz + xw), 1 - 2 * (xx + yy), 0.0f};
+    result.rows[3] = Vec4{0.0f, 0.0f, 0.0f, 1.0f};
+    return result;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vgl/gl.h>
+
+
+namespace vgl::math {
+
+// ===============================================================================================================
+// Types
+// ===============================================================================================================
+// 16 byte aligned so every value is one SSE register. Matrices are row major like the std::array matrices of
+// the renderer and can be uploaded with glUniformMatrix4fv(..., GL_TRUE, ...). Kernels are picked at compile
+// time, AVX for batches, SSE2 for single values and plain loops on everything else. Without FMA contraction
+// (-ffp-contract=off) products and sums are evaluated in the same order as the loops, so every kernel gives
+// bit identical results
+struct alignas(16) Vec3 {
+    GLfloat x = 0.0f;
+    GLfloat y = 0.0f;
+    GLfloat z = 0.0f;
+    // always 0, so positions and directions share the kernels of Vec4
+    GLfloat padding = 0.0f;
+};
+
+struct alignas(16) Vec4 {
+    GLfloat x = 0.0f;
+    GLfloat y = 0.0f;
+    GLfloat z = 0.0f;
+    GLfloat w = 0.0f;
+};
+
+struct alignas(16) Mat4 {
+    std::array<Vec4, 4> rows{};
+};
+
+// unit quaternion, w is the real part
+struct alignas(16) Quat {
+    GLfloat x = 0.0f;
+    GLfloat y = 0.0f;
+    GLfloat z = 0.0f;
+    GLfloat w = 1.0f;
+};
+
+Vec3 toVec3(const std::array<GLfloat, 3>& v);
+Mat4 toMat4(const std::array<std::array<GLfloat, 4>, 4>& m);
+std::array<GLfloat, 3> toArray(const Vec3& v);
+std::array<std::array<GLfloat, 4>, 4> toArray(const Mat4& m);
+
+// ===============================================================================================================
+// Vectors
+// ===============================================================================================================
+Vec3 operator+(const Vec3& a, const Vec3& b);
+Vec3 operator-(const Vec3& a, const Vec3& b);
+Vec3 operator*(GLfloat a, const Vec3& b);
+Vec4 operator+(const Vec4& a, const Vec4& b);
+Vec4 operator-(const Vec4& a, const Vec4& b);
+Vec4 operator*(GLfloat a, const Vec4& b);
+
+GLfloat dot(const Vec3& a, const Vec3& b);
+GLfloat dot(const Vec4& a, const Vec4& b);
+Vec3 cross(const Vec3& a, const Vec3& b);
+GLfloat length(const Vec3& v);
+// the zero vector stays zero instead of turning into NaNs
+Vec3 normalize(const Vec3& v);
+
+// ===============================================================================================================
+// Matrices
+// ===============================================================================================================
+Mat4 identity();
+Mat4 operator*(const Mat4& a, const Mat4& b);
+Vec4 operator*(const Mat4& m, const Vec4& v);
+Mat4 transpose(const Mat4& m);
+// false and result untouched if m is singular
+bool inverse(const Mat4& m, Mat4& result);
+// inverse transpose of the upper 3x3, which keeps normals perpendicular under non uniform scaling. Returned
+// unnormalized as the cofactor matrix, so singular matrices still give usable directions
+Mat4 normalMatrix(const Mat4& m);
+
+// m * (x, y, z, 1) of count points. points holds 3 floats per point like MeshData::vertices, result 4
+Vec4 transformPoint(const Mat4& m, const Vec3& point);
+void transformPoints(const Mat4& m, const GLfloat* points, std::size_t count, GLfloat* result);
+
+// ===============================================================================================================
+// Quaternions
+// ===============================================================================================================
+// axis has to be normalized, angle is in radians
+Quat fromAxisAngle(const Vec3& axis, GLfloat angle);
+Quat operator*(const Quat& a, const Quat& b);
+Quat normalize(const Quat& q);
+Vec3 rotate(const Quat& q, const Vec3& v);
+// rotation in the upper 3x3, the same matrix as Mesh::rotate() builds
+Mat4 toMat4(const Quat& q);
+
+} // namespace vgl::math
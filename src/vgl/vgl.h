@@ -3,5 +3,6 @@
 #include <vgl/gl.h>
 #include <vgl/window.h>
 #include <vgl/renderer.h>
+#include <vgl/meshtools.h>
 #include <vgl/primitives.h>
 #include <vgl/app.h>
\ No newline at end of file